@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit, x must not be 0.
+inline unsigned int CountTrailingZeros(uint32_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_ctz(x));
+#endif
+}
+
+inline unsigned int PopCount(uint32_t x)
+{
+#ifdef _MSC_VER
+	return __popcnt(x);
+#else
+	return static_cast<unsigned int>(__builtin_popcount(x));
+#endif
+}
+
+// 64 bit versions, kept as separate names so narrow masks are not ambiguous.
+inline unsigned int CountTrailingZeros64(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_ctzll(x));
+#endif
+}
+
+inline unsigned int PopCount64(uint64_t x)
+{
+#ifdef _MSC_VER
+	return static_cast<unsigned int>(__popcnt64(x));
+#else
+	return static_cast<unsigned int>(__builtin_popcountll(x));
+#endif
+}
@@ -1,8 +1,7 @@
 #include "board.h"
 #include <iostream>
-#include <chrono>
 #include <cstdlib>
-#include <queue>
+#include <ctime>
 
 #define GLEW_STATIC // Need to define to be able to statically link.
 #include <glew.h>
@@ -12,15 +11,17 @@
 #include "shader.h"
 
 Board::Board(int width, int height)
+	: m_input(&m_game)
 {
-	// Set each block to be unoccupied.
-	for (int i = 0; i < m_numRows; i++)
-	{
-		for (int j = 0; j < m_numCols; j++)
-		{
-			m_occupiedBlocks[i][j] = false;
-		}
-	}
+	// Keep track of the colour of the blocks as they are locked and cleared.
+	m_game.SetObserver(this);
+
+	// Every run gets a different piece order.
+	m_game.Seed(static_cast<uint64_t>(time(NULL)));
+
+	m_pieceLocked = false;
+	ResetHistory();
+	m_botEnabled = false;
 
 	m_block_length = 2.f / (m_numRows + 1);
 	m_LeftXCord = -5.0f * m_block_length;
@@ -30,17 +31,13 @@ Board::Board(int width, int height)
 	m_vertices = std::vector<float>();
 	m_indices = std::vector<unsigned int>();
 
-	m_moveX = 0;
-	m_moveY = 0;
-	m_ActivePiece = false;
-	m_FlipPiece = false;
-
 	// Create the board of tetris.
 	this->createSides(m_LeftXCord);
 	this->createSides(m_RightXCord);
 	this->createBottom(m_LeftXCord + m_block_length);
 	
 	m_firstPieceIndex = static_cast<unsigned int>(m_vertices.size());
+	m_firstPieceElement = m_indices.size();
 
 	/* ---------- Generate the handles to the opengl objects ------------ */
 	
@@ -93,14 +90,13 @@ void Board::Render()
 {
 	glBindVertexArray(m_vao);
 
-	if (!m_ActivePiece)
-	{
-		SpawnPiece();
-		glNamedBufferData(m_ebo, sizeof(unsigned int) * numIndices(), getIndexPointer(), GL_STREAM_DRAW);
-	}
+	// Generate the vertices for the locked blocks and the falling piece from the board state.
+	CreatePieceBlocks();
+
 	m_shaderProg.use();
 	glUniform1i(glGetUniformLocation(m_shaderProg.program(), "blockTexture"), 0);
 	glNamedBufferData(m_bufferHandle, sizeof(float) * numVertices(), getVertexPointer(), GL_STREAM_DRAW);
+	glNamedBufferData(m_ebo, sizeof(unsigned int) * numIndices(), getIndexPointer(), GL_STREAM_DRAW);
 	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(numIndices()), GL_UNSIGNED_INT, 0);
 
 	// Block until we are done drawing the elements, avoid swaping to an unfinished frame buffer
@@ -118,339 +114,139 @@ void Board::createBottom(float xPos)
 }
 
 
-
-void Board::Update()
+/*
+	Runs one fixed time step of the game, applying the input received since the last step.
+*/
+void Board::Update(double time)
 {
-	if (m_currentPieceIndex == 0)
+	// Start a new game once the stack reaches the top of the board.
+	if (m_game.IsGameOver())
 	{
-		m_moveX = 0;
-		m_moveY = 0;
-
-		return;
+		m_game.Reset();
+		ResetHistory();
 	}
 
-	// Add downwards momentum if we have elapsed 0.5 s.
-	std::chrono::duration<float> elapsed_seconds = std::chrono::system_clock::now() - m_timer;
-	if (elapsed_seconds.count() > 0.5f)
-	{
-		m_moveY = -1 + m_moveY;
-		m_timer = std::chrono::system_clock::now();
-	}
+	// Apply the keys pressed up to the end of this tick, then spawn pieces and apply gravity.
+	if (m_botEnabled)
+		m_bot->Update(m_game, m_input, time);
+	m_input.Update(time);
+	m_game.Tick();
 
-	// Move in the x direction if necessary.
-	if (m_moveX != 0)
+	if (m_pieceLocked)
 	{
-		bool illegalMove = false;
-		for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += (c_NUM_ELEMENTS_PER_VERT * 4))
-		{
-			float newMove = m_vertices[i] + (m_block_length * m_moveX);
-			
-			// Make sure the move is not out of bounds and there are not already pieces there.
-			if (newMove < GetXPosition(0) || newMove > GetXPosition(m_numCols - 1))
-			{
-				illegalMove = true;
-				break;
-			}
-			else if (m_occupiedBlocks[GetYIndex(m_vertices[i + 1])][GetXIndex(newMove)])
-			{
-				illegalMove = true;
-			}
-
-		}
-
-		// Move the piece in the x axis if the move is legal.
-		if (!illegalMove) 
-		{
-			for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += c_NUM_ELEMENTS_PER_VERT)
-			{
-				m_vertices[i] += m_block_length * m_moveX;
-			}
-		}
-
-		m_moveX = 0;
+		m_history.Record(TakeSnapshot());
+		m_pieceLocked = false;
 	}
+}
 
-	// Move in the y direction if needed.
-	if (m_moveY != 0)
-	{
-		bool illegalMove = false;
+bool Board::Undo()
+{
+	// Going back from the piece still falling drops it along with the last one placed.
+	if (!m_history.Undo())
+		return false;
 
-		for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += (c_NUM_ELEMENTS_PER_VERT * 4))
-		{
-			float newY = m_vertices[i + 1] + (m_block_length * m_moveY);
-			
-			// Check each possible block location from 1 to m_moveY below the current location.
-			if (m_moveY != -1)
-			{
-				int temp = m_moveY;
-
-				// Check if the next block is an illegal move and skip the 
-				// for loop if it is illegal.
-				newY = m_vertices[i + 1] + (-m_block_length);
-				if (newY < GetYPosition(m_numRows - 1))
-				{
-					illegalMove = true;
-				}
-				else if (m_occupiedBlocks[GetYIndex(newY)][GetXIndex(m_vertices[i])])
-				{
-					illegalMove = true;
-				}
-				else 
-				{
-					for (int j = -1; j >= m_moveY; j--)
-					{
-						newY = m_vertices[i + 1] + (m_block_length * j);
-						if (newY < GetYPosition(m_numRows - 1))
-						{
-							break;
-						}
-						else if (m_occupiedBlocks[GetYIndex(newY)][GetXIndex(m_vertices[i])])
-						{
-							break;
-						}
-
-						temp = j;
-					}
-					m_moveY = temp;
-				}
-				
-			}
-			// Check to see if the next row is the last row or there is already a piece on that row.
-			else if (newY < GetYPosition(m_numRows - 1))
-			{
-				illegalMove = true;
-			}
-			else if (m_occupiedBlocks[GetYIndex(newY)][GetXIndex(m_vertices[i])])
-			{
-				illegalMove = true;
-			}
-			
-		}
+	RestoreSnapshot(m_history.GetState());
+	return true;
+}
 
-		if (!illegalMove)
-		{
-			// Move the piece along the y axis.
-			for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += c_NUM_ELEMENTS_PER_VERT)
-			{
-				m_vertices[i + 1] += m_block_length * m_moveY;
-			}
-			m_moveY = 0;
-		}
+bool Board::Redo()
+{
+	if (!m_history.Redo())
+		return false;
 
-		if (illegalMove)
-		{
-			// Occupy the spaces in the board so the player can no longer go there.
-			for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += (c_NUM_ELEMENTS_PER_VERT * 4))
-			{
-				m_occupiedBlocks[GetYIndex(m_vertices[i + 1])][GetXIndex(m_vertices[i])] = true;
-			}
+	RestoreSnapshot(m_history.GetState());
+	return true;
+}
 
-			// Check if there is a full line to erase
-			for (unsigned int row = 0; row < m_numRows; row++)
-			{
-				bool deleteRow = true;
-				for (unsigned int col = 0; col < m_numCols; col++)
-				{
-					if (!m_occupiedBlocks[row][col])
-					{
-						deleteRow = false;
-						break;
-					}
-				}
-
-				if (deleteRow)
-				{
-					// Delete the row that are full and shift the rest of the rows down.
-					DeleteRow(row);
-				}
-			}
+Board::Snapshot Board::TakeSnapshot() const
+{
+	Snapshot snapshot;
+	m_game.SaveState(snapshot.game);
+	snapshot.blockTypes = m_blockTypes;
+	return snapshot;
+}
 
+void Board::RestoreSnapshot(const Snapshot& snapshot)
+{
+	m_game.RestoreState(snapshot.game);
+	m_blockTypes = snapshot.blockTypes;
+}
 
-			m_ActivePiece = false;
-			m_currentPieceIndex = 0;
-		}
-		
-		m_moveY = 0;
-	}
+void Board::ResetHistory()
+{
+	// The game has just started on an empty board, so no colours carry over into the journal's first snapshot.
+	for (auto& row : m_blockTypes)
+		row.fill(c_GARBAGE_BLOCK);
 
+	m_history.Reset(TakeSnapshot());
+}
 
-	// Flip the piece
-	if (m_FlipPiece && m_ActivePiece)
-	{
-		bool illegalMove = false;
+unsigned int Board::GetTicksUntilUpdate() const
+{
+	// A finished game is restarted on the next update.
+	if (m_game.IsGameOver())
+		return 1;
 
-		// Get the second block and calculate the origin in terms of the origin
-		int start = c_NUM_ELEMENTS_PER_VERT * 4 + m_currentPieceIndex;
+	// The bot presses keys every tick while it has a piece to move.
+	if (m_botEnabled && m_bot->IsPlaying(m_game))
+		return 1;
 
-		// Use the first 3 vertices to calculate origin, first x0 - x1, then y1 - y2
-		// Get the roation x and y origins.
-		float block_origin[2];
-		block_origin[0] = m_vertices[start] + m_block_length;
-		block_origin[1] = m_vertices[start + 1] - m_block_length;
+	unsigned int ticks = m_game.GetTicksUntilUpdate();
+	unsigned int inputTicks = m_input.GetTicksUntilUpdate();
+	return inputTicks < ticks ? inputTicks : ticks;
+}
 
-		// 4 vertieces * 2 vertex data * 4 number of blocks per piece
-		float new_verts[32] = { 0 };
+void Board::OnPieceLocked(const PieceState& piece)
+{
+	Cell cells[c_MAX_PIECE_BLOCKS];
+	unsigned int numCells = GetPieceCells(piece, cells, m_game.GetPieceSet());
 
-		int j = 0;
-		for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += c_NUM_ELEMENTS_PER_VERT)
-		{
-			float prev_x = m_vertices[i] - block_origin[0];
-			float prev_y = m_vertices[i + 1] - block_origin[1];
-			
-			float new_x = (-prev_y  + block_origin[0]);
-			float new_y = (prev_x + block_origin[1]);
-			
-			new_verts[j] = new_x;
-			new_verts[j + 1] = new_y;
-
-			// Check to see if the player is in bounds and the block is not occupied.
-			if (GetXIndex(new_verts[j]) < 0 || GetXIndex(new_verts[j]) > (m_numCols - 1))
-			{
-				illegalMove = true;
-				break;
-			}
-			else if (GetYIndex(new_verts[j + 1]) > (m_numRows))
-			{
-				illegalMove = true;
-				break;
-			}
-			else if (m_occupiedBlocks[GetYIndex(new_y)][GetXIndex(new_x)])
-			{
-				illegalMove = true;
-				break;
-			}
-			j += 2;
-		}
+	for (unsigned int i = 0; i < numCells; i++)
+	{
+		m_blockTypes[cells[i].row][cells[i].col] = piece.type;
+	}
 
+	m_pieceLocked = true;
+}
 
-		if (!illegalMove)
+void Board::OnRowsCleared(uint64_t rows)
+{
+	// Move the colours of the rows that are left down over the cleared ones.
+	int dest = m_numRows - 1;
+	for (int row = m_numRows - 1; row >= 0; row--)
+	{
+		if (!(rows & (1ull << row)))
 		{
-			//PrintOccupied();
-
-			// Rotation counter-clockwise messes up the drawing order of the vertices,
-			// and therefore affects how the blocks are located with the GetIndex functions.
-			// Re-arrange the blocks on how they are drawn
-			for (int block = 0; block < 4; block++)
-			{
-				float temp[2];
-
-				// Assume 0-based indexing in the new vertex array.
-				// Need to sort the new array in this new order:
-				// 1 -> 0,  3 -> 1, 0 -> 2, 2 -> 3
-
-				// 1 -> 0 
-				temp[0] = new_verts[block * 8];
-				temp[1] = new_verts[block * 8 + 1];
-				new_verts[block * 8] = new_verts[block * 8 + (2 * 1)];
-				new_verts[block * 8 + 1] = new_verts[block * 8 + (2 * 1) + 1];
-
-				// 3 -> 1
-				new_verts[block * 8 + (2 * 1)] = new_verts[block * 8 + (2 * 3)];
-				new_verts[block * 8 + (2 * 1) + 1] = new_verts[block * 8 + (2 * 3) + 1];
-
-				// 2 -> 3
-				new_verts[block * 8 + (2 * 3)] = new_verts[block * 8 + (2 * 2)];
-				new_verts[block * 8 + (2 * 3) + 1] = new_verts[block * 8 + (2 * 2) + 1];
-
-				// 0 -> 2
-				new_verts[block * 8 + (2 * 2)] = temp[0];
-				new_verts[block * 8 + (2 * 2) + 1] = temp[1];
-			}
-
-			// Assing the new vertices to the vertex buffer.
-			j = 0;
-			for (int i = m_currentPieceIndex; i < (m_vertices.size()); i += c_NUM_ELEMENTS_PER_VERT)
-			{
-				m_vertices[i] = new_verts[j];
-				m_vertices[i + 1] = new_verts[j + 1]; 
-				j += 2;
-			}
+			m_blockTypes[dest--] = m_blockTypes[row];
 		}
-		m_FlipPiece = false;
 	}
 }
 
-void Board::DeleteRow(unsigned int row)
+void Board::OnClusterDropped(const Playfield::RowArray& cluster, unsigned int distance)
 {
-	std::array<unsigned int, m_numCols> deleted_blocks;
-	std::queue<unsigned int> unfound_indices;
-
-
-	for (unsigned int i = 0; i < m_numCols; i++)
-	{
-		unfound_indices.push(i);
-	}
-	
-	// go through and find all of the blocks in the deletion row
-	int block = 0;
-	unsigned int search_idx = unfound_indices.front();
-
-	while (!unfound_indices.empty())
+	// Move the colours of the cluster, bottom row first so none are overwritten before they move.
+	for (unsigned int row = m_numRows; row-- > 0;)
 	{
-		for (unsigned int i = m_firstPieceIndex; i < m_vertices.size(); i += c_NUM_ELEMENTS_PER_VERT * 4)
+		for (unsigned int col = 0; col < m_numCols; col++)
 		{
-			// Add the location of the zeroed data to the array
-			if ((GetXIndex(m_vertices[i]) == unfound_indices.front()) && (GetYIndex(m_vertices[i + 1]) == row))
-			{
-				deleted_blocks[block++] = i;
-				unfound_indices.pop();
-
-				if (unfound_indices.empty())
-				{
-					break;
-				}
-			}
+			if ((cluster[row] >> col) & 1u)
+				m_blockTypes[row + distance][col] = m_blockTypes[row][col];
 		}
 	}
+}
 
-	// Sort the indexes in deleted_blocks.
-	std::sort(deleted_blocks.begin(), deleted_blocks.end());
-
-	// Update the vertex buffer to remove the empty gaps in memory to avoid infinite
-	// allocation of memory. Loop in reverse because erase resizes the buffer once
-	// the values are removed.
-	for (int i = (static_cast<int>(deleted_blocks.size() - 1)) ; i > -1; i--)
+void Board::OnGarbageInserted(unsigned int lines, unsigned int holeCol)
+{
+	// Move the colours up with the stack and colour the new rows as garbage.
+	for (unsigned int row = 0; row + lines < m_numRows; row++)
 	{
-		// Get the insertion point and all the values before the next deleted blocks location.
-		unsigned int insertion_point = deleted_blocks[i];
-
-		// Get the end of all the deleted block. number of vertices * number of elements per vertex.
-		unsigned int valid_blocks_start = deleted_blocks[i] + 4 * c_NUM_ELEMENTS_PER_VERT;
-
-		m_vertices.erase(m_vertices.begin() + insertion_point, m_vertices.begin() + valid_blocks_start);
+		m_blockTypes[row] = m_blockTypes[row + lines];
 	}
 
-	// Remove the number of column blocks of indieces that were erased to match the ratio of indices to vertices.
-	// There are 28 vertices and 6 indices that make up one block.
-	m_indices.erase(m_indices.begin() + ((numVertices() * 3) / 14), m_indices.begin() + ((numVertices() * 3) / 14) + (6 * m_numCols));
-
-	// Update the locations of the blocks.
-	for (int i = m_firstPieceIndex; i < m_vertices.size(); i+= c_NUM_ELEMENTS_PER_VERT * 4)
+	for (unsigned int row = lines < m_numRows ? m_numRows - lines : 0; row < m_numRows; row++)
 	{
-		//bool occupied = m_occupiedBlocks[GetYIndex(m_vertices[i + 1])][GetXIndex(m_vertices[i])];
-		if ((m_vertices[i + 1] > GetYPosition(row)))
-		{
-			// Move the piece down one square ????
-			for (unsigned int j = 0; j < 4; j++)
-			{
-				float val = GetYPosition(GetYIndex(m_vertices[i + (c_NUM_ELEMENTS_PER_VERT * j) + 1]) + 1);
-				m_vertices[i + (c_NUM_ELEMENTS_PER_VERT * j) + 1] -=  m_block_length;
-			}
-		}
+		m_blockTypes[row].fill(c_GARBAGE_BLOCK);
 	}
-
-	// Remove all previous occupied blocks.
-	for (unsigned int i = 0; i < m_numRows; i++)
-		for (unsigned int j = 0; j < m_numCols; j++)
-			m_occupiedBlocks[i][j] = false;
-
-	// Set the new location to occupied
-	for (int i = m_firstPieceIndex; i < m_vertices.size(); i += c_NUM_ELEMENTS_PER_VERT * 4)
-		m_occupiedBlocks[GetYIndex(m_vertices[i + 1])][GetXIndex(m_vertices[i])] = true;
-
-
-	// TODO: Add score
-
 }
 
 void Board::PrintOccupied()
@@ -460,7 +256,7 @@ void Board::PrintOccupied()
 	{
 		for (int j = 0; j < m_numCols; j++)
 		{
-			std::cout << (m_occupiedBlocks[i][j] ? "   " : " x ");
+			std::cout << (m_game.GetPlayfield().IsOccupied(i, j) ? "   " : " x ");
 		}
 		std::cout << std::endl;
 	}
@@ -468,7 +264,6 @@ void Board::PrintOccupied()
 	std::cout << "\n================================\n";
 }
 
-
 void Board::createSides(float xPos)
 {
 	for (int i = 0; i < (m_numRows + 1); i++)
@@ -477,9 +272,10 @@ void Board::createSides(float xPos)
 	}
 }
 
-void Board::CreateBlock(float xPos, float yPos, float r, float g, float b)
+void Board::CreateBlock(float xPos, float yPos, float r, float g, float b, float scale)
 {
 	unsigned int vert_idx = numVertices() / c_NUM_ELEMENTS_PER_VERT;
+	const float length = m_block_length * scale;
 
 	// Update the Vertex Buffer
 	// Top left
@@ -492,7 +288,7 @@ void Board::CreateBlock(float xPos, float yPos, float r, float g, float b)
 	m_vertices.push_back(b);
 
 	// Top right
-	m_vertices.push_back(xPos + m_block_length);			// x-pos
+	m_vertices.push_back(xPos + length);			// x-pos
 	m_vertices.push_back(yPos);								// y-pos
 	m_vertices.push_back(1.0f);								// s-pos
 	m_vertices.push_back(1.0f);								// t-pos
@@ -502,7 +298,7 @@ void Board::CreateBlock(float xPos, float yPos, float r, float g, float b)
 
 	// Bottom Left
 	m_vertices.push_back(xPos);								// x-pos
-	m_vertices.push_back(yPos - m_block_length);			// y-pos
+	m_vertices.push_back(yPos - length);			// y-pos
 	m_vertices.push_back(0.0f);								// s-pos
 	m_vertices.push_back(0.0f);								// t-pos
 	m_vertices.push_back(r);
@@ -510,8 +306,8 @@ void Board::CreateBlock(float xPos, float yPos, float r, float g, float b)
 	m_vertices.push_back(b);
 
 	// Bottom right
-	m_vertices.push_back(xPos + m_block_length);			// x-pos
-	m_vertices.push_back(yPos - m_block_length);			// y-pos
+	m_vertices.push_back(xPos + length);			// x-pos
+	m_vertices.push_back(yPos - length);			// y-pos
 	m_vertices.push_back(1.0f);								// s-pos
 	m_vertices.push_back(0.0f);								// t-pos
 	m_vertices.push_back(r);
@@ -541,117 +337,73 @@ float Board::GetYPosition(int y)
 	return 1.0f - (y * m_block_length);
 }
 
-unsigned int Board::GetXIndex(float x)
-{
-	return static_cast<unsigned int>(round((x - m_LeftXCord -  m_block_length) / m_block_length));
-}
-
-unsigned int Board::GetYIndex(float y)
-{
-	// Need to round to not loose data from converting to unsinged int occasionally.
-	return  static_cast<unsigned>(round((y - 1.0f) / (-m_block_length)));
-}
-
-void Board::CreatePiece(const char piece_type)
+void Board::CreatePieceBlocks()
 {
+	// Drop the blocks from the previous frame, the walls stay at the front of the buffers.
+	m_vertices.resize(m_firstPieceIndex);
+	m_indices.resize(m_firstPieceElement);
 
-	switch (piece_type)
-	{
-	case 'O':
-	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(0);
-
-		CreateBlock(spawnStartX, spawnStartY, 1.0f, 1.0f, 0.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY, 1.0f, 1.0f, 0.0f);
-		CreateBlock(spawnStartX, spawnStartY - m_block_length, 1.0f, 1.0f, 0.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY - m_block_length, 1.0f, 1.0f, 0.0f);
-		break;
-	}
-	case 'I':
+	const PieceSet& pieces = m_game.GetPieceSet();
+	const Playfield& field = m_game.GetPlayfield();
+	for (unsigned int row = 0; row < m_numRows; row++)
 	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(0);
-		
-		CreateBlock(spawnStartX - m_block_length, spawnStartY, 0.0f, 1.0f, 1.0f);
-		CreateBlock(spawnStartX, spawnStartY, 0.0f, 1.0f, 1.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY, 0.0f, 1.0f, 1.0f);
-		CreateBlock(spawnStartX + (2 * m_block_length), spawnStartY, 0.0f, 1.0f, 1.0f);
-		break;
-	}
-	case 'J':
-	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(1);
-		
-		CreateBlock(spawnStartX - m_block_length, spawnStartY + m_block_length, 0.0f, 0.0f, 1.0f);
-		CreateBlock(spawnStartX - m_block_length, spawnStartY, 0.0f, 0.0f, 1.0f);
-		CreateBlock(spawnStartX, spawnStartY, 0.0f, 0.0f, 1.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY, 0.0f, 0.0f, 1.0f);
-		break;
-	}
-	case 'L':
-	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(1);
-
-		CreateBlock(spawnStartX - m_block_length, spawnStartY, 1.0f, 0.5f, 0.0f);
-		CreateBlock(spawnStartX, spawnStartY, 1.0f, 0.5f, 0.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY, 1.0f, 0.5f, 0.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY + m_block_length, 1.0f, 0.5f, 0.0f);
-		break;
+		for (unsigned int col = 0; col < m_numCols; col++)
+		{
+			if (field.IsOccupied(row, col))
+			{
+				const PieceType type = m_blockTypes[row][col];
+				const float* color = type == c_GARBAGE_BLOCK ? c_GARBAGE_COLOR : pieces.colors[static_cast<int>(type)];
+				CreateBlock(GetXPosition(col), GetYPosition(row), color[0], color[1], color[2]);
+			}
+		}
 	}
-	case 'S':
+
+	if (m_game.HasActivePiece())
 	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(1);
-
-		CreateBlock(spawnStartX - m_block_length, spawnStartY, 0.0f, 1.0f, 0.0f);
-		CreateBlock(spawnStartX, spawnStartY, 0.0f, 1.0f, 0.0f);
-		CreateBlock(spawnStartX, spawnStartY + m_block_length, 0.0f, 1.0f, 0.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY + m_block_length, 0.0f, 1.0f, 0.0f);
-		break;
+		const PieceState& piece = m_game.GetPiece();
+		Cell cells[c_MAX_PIECE_BLOCKS];
+		unsigned int numCells = GetPieceCells(piece, cells, pieces);
+
+		const float* color = pieces.colors[static_cast<int>(piece.type)];
+		for (unsigned int i = 0; i < numCells; i++)
+		{
+			CreateBlock(GetXPosition(cells[i].col), GetYPosition(cells[i].row), color[0], color[1], color[2]);
+		}
 	}
-	case 'T':
+
+	// The held piece sits to the left of the board and the queue runs down the right.
+	const float gap = c_PREVIEW_SCALE * m_block_length;
+	if (m_game.HasHeldPiece())
 	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(1);
-
-		CreateBlock(spawnStartX - m_block_length, spawnStartY, 0.5f, 0.0f, 0.5f);
-		CreateBlock(spawnStartX, spawnStartY, 0.5f, 0.0f, 0.5f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY, 0.5f, 0.0f, 0.5f);
-		CreateBlock(spawnStartX, spawnStartY + m_block_length, 0.5f, 0.0f, 0.5f);
-		break;
+		const PieceRotation& rotation = pieces.GetRotation(m_game.GetHeldPiece(), 0);
+		float width = (rotation.maxCol - rotation.minCol + 1) * c_PREVIEW_SCALE * m_block_length;
+		CreatePreviewBlocks(m_game.GetHeldPiece(), GetXPosition(-1) - gap - width, GetYPosition(1));
 	}
-	case 'Z':
+
+	const PieceQueue& queue = m_game.GetQueue();
+	float yPos = GetYPosition(1);
+	for (unsigned int i = 0; i < queue.Size() && yPos > -1.0f; i++)
 	{
-		float spawnStartX = GetXPosition(4);
-		float spawnStartY = GetYPosition(1);
-
-		CreateBlock(spawnStartX - m_block_length, spawnStartY + m_block_length, 1.0f, 0.0f, 0.0f);
-		CreateBlock(spawnStartX, spawnStartY + m_block_length, 1.0f, 0.0f, 0.0f);
-		CreateBlock(spawnStartX, spawnStartY, 1.0f, 0.0f, 0.0f);
-		CreateBlock(spawnStartX + m_block_length, spawnStartY, 1.0f, 0.0f, 0.0f);
-		break;
-	}
+		yPos -= CreatePreviewBlocks(queue[i], GetXPosition(m_numCols + 1) + gap, yPos) + gap;
 	}
 }
 
-void Board::SpawnPiece()
+float Board::CreatePreviewBlocks(PieceType type, float xPos, float yPos)
 {
-	int numBlocks = 4;
-	int blockVerts = 4;
-	int numInsert = numBlocks * blockVerts * 4;
-
-	m_currentPieceIndex = numVertices();
+	const PieceSet& pieces = m_game.GetPieceSet();
+	const PieceRotation& rotation = pieces.GetRotation(type, 0);
+	const float* color = pieces.colors[static_cast<int>(type)];
+	const float length = c_PREVIEW_SCALE * m_block_length;
 
-	char pieces[] = "OIJLSTZ";
-	srand(static_cast<unsigned int>(time(NULL)));
-	CreatePiece(pieces[rand() % 7]);
-	
-	m_ActivePiece = true;
+	// Line the blocks up with the top left corner, whatever the size of the bounding box.
+	for (int i = 0; i < rotation.numBlocks; i++)
+	{
+		float x = xPos + (rotation.blocks[i].col - rotation.minCol) * length;
+		float y = yPos - (rotation.blocks[i].row - rotation.minRow) * length;
+		CreateBlock(x, y, color[0], color[1], color[2], c_PREVIEW_SCALE);
+	}
 
-	static auto m_time = std::chrono::system_clock::now();
+	return (rotation.maxRow - rotation.minRow + 1) * length;
 }
 
 unsigned int Board::numVertices()
@@ -664,21 +416,36 @@ size_t Board::numIndices()
 	return m_indices.size();
 }
 
-void Board::SetMoveDirection(int x, int y)
+void Board::Press(InputAction action, double time)
 {
-	m_moveX = x;
-	m_moveY = y;
+	m_input.Press(action, time);
+}
+
+void Board::Release(InputAction action, double time)
+{
+	m_input.Release(action, time);
+}
+
+void Board::SetBotEnabled(bool enabled, double time)
+{
+	if (enabled && !m_bot)
+		m_bot.reset(new BotController());
+
+	if (!enabled && m_botEnabled)
+		m_bot->ReleaseKeys(m_input, time);
+
+	m_botEnabled = enabled;
 }
 
-void Board::Flip()
+bool Board::IsBotEnabled() const
 {
-	m_FlipPiece = true;
+	return m_botEnabled;
 }
 
-void Board::Drop()
+void Board::SetPieceSet(const PieceSet* pieces)
 {
-	if (m_ActivePiece)
-		m_moveY = -(static_cast<int>(m_numRows) - 1);
+	m_game.SetPieceSet(pieces);
+	ResetHistory();
 }
 
 float* Board::getVertexPointer()
@@ -1,58 +1,90 @@
 #pragma once
 #include <vector>
 #include <array>
-#include <chrono>
+#include <memory>
 #include "shader.h"
+#include "game.h"
+#include "input.h"
+#include "journal.h"
+#include "bot.h"
 
 
-class Board
+class Board : public GameObserver
 {
 public:
 	Board(int width, int height);
 	~Board();
-	void Update();
+	// Runs one tick of the game, time being when the tick ends on the clock the input is timestamped with.
+	void Update(double time);
+	// Ticks until the next one that changes anything on screen, so the host can sleep until then. Game::c_NO_DEADLINE if none.
+	unsigned int GetTicksUntilUpdate() const;
 	void Render();
-	void SpawnPiece();
 	float* getVertexPointer();
 	unsigned int* getIndexPointer();
 	unsigned int numVertices();
 	size_t numIndices();
-	void SetMoveDirection(int x, int y);
-	void Flip();
-	void Drop();
+	void Press(InputAction action, double time);
+	void Release(InputAction action, double time);
+
+	// Starts a new game with the given pieces, which must outlive the board.
+	void SetPieceSet(const PieceSet* pieces);
+
+	// Takes back the last piece placed, or places it again. Returns false if there is nothing to step to.
+	bool Undo();
+	bool Redo();
+
+	// Lets the bot play in place of the keys, time being when it takes over or hands back.
+	void SetBotEnabled(bool enabled, double time);
+	bool IsBotEnabled() const;
+
+	void OnPieceLocked(const PieceState& piece) override;
+	void OnRowsCleared(uint64_t rows) override;
+	void OnClusterDropped(const Playfield::RowArray& cluster, unsigned int distance) override;
+	void OnGarbageInserted(unsigned int lines, unsigned int holeCol) override;
 
 private:
 	void createSides(float xPos);
-	void CreateBlock(float xPos, float yPos, float r, float g, float b);
+	void CreateBlock(float xPos, float yPos, float r, float g, float b, float scale = 1.0f);
+	void CreatePieceBlocks();
+	float CreatePreviewBlocks(PieceType type, float xPos, float yPos); // Returns the height of the piece
+	static constexpr float c_PREVIEW_SCALE = 0.5f; // The queue and held piece are drawn at half size
 	float GetXPosition(int x);
 	float GetYPosition(int y);
-	unsigned int GetXIndex(float x);
-	unsigned int GetYIndex(float y);
-	void CreatePiece(const char piece_type);
 	void createBottom(float xPos);
 	std::vector<float> m_vertices;
 	static constexpr unsigned int c_NUM_ELEMENTS_PER_VERT = 7;
 	std::vector<unsigned int> m_indices;
-	static constexpr unsigned int m_numRows = 20;
-	static constexpr unsigned int m_numCols = 10;
-	std::array<std::array< bool, m_numCols>, m_numRows> m_occupiedBlocks; // rows x columns
+	static constexpr unsigned int m_numRows = Playfield::c_NUM_ROWS;
+	static constexpr unsigned int m_numCols = Playfield::c_NUM_COLS;
+	Game m_game;
+	InputHandler m_input;
+	static constexpr PieceType c_GARBAGE_BLOCK = static_cast<PieceType>(c_MAX_PIECE_TYPES); // Stands in for a piece type in m_blockTypes
+	static constexpr float c_GARBAGE_COLOR[3] = { 0.4f, 0.4f, 0.4f };
+	using BlockTypes = std::array<std::array<PieceType, m_numCols>, m_numRows>;
+	BlockTypes m_blockTypes; // Piece each locked block came from, used for colour
+
+	// What undo and redo step through, recorded after every piece locks.
+	struct Snapshot
+	{
+		GameState game;
+		BlockTypes blockTypes;
+	};
+
+	Snapshot TakeSnapshot() const;
+	void RestoreSnapshot(const Snapshot& snapshot);
+	void ResetHistory();
+	Journal<Snapshot> m_history;
+	bool m_pieceLocked; // A piece locked during this tick
+	std::unique_ptr<BotController> m_bot; // Made the first time the bot is enabled, it starts a thread pool
+	bool m_botEnabled;
 	float m_RightXCord;
 	float m_LeftXCord;
-	
-	bool m_ActivePiece;
-	bool m_FlipPiece;
-	std::chrono::system_clock::time_point m_timer;
 
 	ShaderProgram m_shaderProg;
 	GLuint m_bufferHandle, m_vao, m_ebo;
 	float m_block_length;
 
-	void DeleteRow(unsigned int row);
 	void PrintOccupied();
-	unsigned int m_currentPieceIndex;
 	unsigned int m_firstPieceIndex;
-
-	int m_moveX;
-	int m_moveY;
-	float m_moveSpeed;
+	size_t m_firstPieceElement;
 };
@@ -0,0 +1,510 @@
+#include "bot.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include "zobrist.h"
+
+// Orders of the children of one parent, apart for placing the piece and for holding it.
+static constexpr uint32_t c_ORDERS_PER_PARENT = 2 * MoveGenerator::c_MAX_PLACEMENTS;
+static_assert(static_cast<uint64_t>(BeamSearch::c_MAX_BEAM_WIDTH) * c_ORDERS_PER_PARENT <= UINT32_MAX, "Node orders must fit in 32 bits");
+
+// Key for the combo and back-to-back a board carries into its next clear.
+static uint64_t GetClearStateKey(uint8_t combo, bool backToBack)
+{
+	return SplitMix64(0xF300 + combo * 2u + (backToBack ? 1 : 0));
+}
+
+// Salt for the keys of a layer. SplitMix64 is one to one and every other key hashes a small number, so the top bit keeps these apart.
+static uint64_t GetLayerKey(uint64_t layer)
+{
+	return SplitMix64((1ull << 63) | layer);
+}
+
+/*
+	A reward and a node order packed so that comparing the numbers ranks the
+	nodes the way BeamSearch::IsBetter does for copies of one board: the float's
+	bits flipped so they compare as unsigned, then the order reversed.
+*/
+static uint64_t PackRank(float score, uint32_t order)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &score, sizeof(bits));
+	bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+
+	return (static_cast<uint64_t>(bits) << 32) | (UINT32_MAX - order);
+}
+
+BeamSearch::BeamSearch(unsigned int numThreads, size_t tableBytes)
+	: m_pool(numThreads), m_table(tableBytes)
+{
+	for (unsigned int i = 0; i < m_pool.GetNumThreads(); i++)
+	{
+		m_workers.emplace_back(new Worker());
+	}
+
+	m_weights = c_DEFAULT_BOT_WEIGHTS;
+	m_beamWidth = c_DEFAULT_BEAM_WIDTH;
+	m_maxDepth = PieceQueue::c_MAX_DEPTH + 1;
+	m_pieces = &c_STANDARD_PIECES;
+	m_rule = SpinRule::T_SPIN;
+	m_canHold = false;
+	m_numPieces = 0;
+	m_numLayers = 0;
+	m_layerKey = 0;
+	m_nodes = 0;
+	m_transpositions = 0;
+}
+
+void BeamSearch::SetWeights(const BotWeights& weights)
+{
+	m_weights = weights;
+}
+
+const BotWeights& BeamSearch::GetWeights() const
+{
+	return m_weights;
+}
+
+void BeamSearch::SetBeamWidth(unsigned int width)
+{
+	m_beamWidth = width < 1 ? 1 : (width > c_MAX_BEAM_WIDTH ? c_MAX_BEAM_WIDTH : width);
+}
+
+void BeamSearch::SetMaxDepth(unsigned int depth)
+{
+	m_maxDepth = depth > 0 ? depth : 1;
+}
+
+uint64_t BeamSearch::GetNodeCount() const
+{
+	return m_nodes;
+}
+
+uint64_t BeamSearch::GetTranspositionCount() const
+{
+	return m_transpositions;
+}
+
+bool BeamSearch::Search(const GameState& state, const PieceSet& pieces, SpinRule rule, BotMove& move)
+{
+	m_nodes = 0;
+	m_transpositions = 0;
+	if (!state.activePiece || state.gameOver)
+		return false;
+
+	m_pieces = &pieces;
+	m_rule = rule;
+	m_piece = state.piece;
+	m_canHold = !state.holdUsed;
+
+	m_numPieces = 0;
+	m_sequence[m_numPieces++] = state.piece.type;
+	for (unsigned int i = 0; i < state.queue.Size(); i++)
+	{
+		m_sequence[m_numPieces++] = state.queue[i];
+	}
+
+	// The pieces to come are hashed by where they are in the queue from each point on.
+	m_queueKeys[m_numPieces] = 0;
+	for (unsigned int next = 0; next < m_numPieces; next++)
+	{
+		m_queueKeys[next] = 0;
+		for (unsigned int i = next; i < m_numPieces; i++)
+		{
+			m_queueKeys[next] ^= ZobristQueueKey(i - next, m_sequence[i]);
+		}
+	}
+
+	Node root;
+	root.field = state.field;
+	root.score = 0.0f;
+	root.value = 0.0f;
+	root.order = 0;
+	root.first = BotMove();
+	root.next = 0;
+	root.hold = state.hold;
+	root.hasHold = state.hasHold;
+	root.combo = state.combo;
+	root.backToBack = state.backToBack;
+	m_layer.assign(1, root);
+
+	bool found = false;
+	for (unsigned int depth = 0; depth < m_maxDepth; depth++)
+	{
+		for (std::unique_ptr<Worker>& worker : m_workers)
+		{
+			worker->children.clear();
+			worker->nodes = 0;
+			worker->transpositions = 0;
+		}
+		m_layerKey = GetLayerKey(++m_numLayers);
+
+		// Parents are handed out one at a time, some have far more placements than others.
+		std::atomic<size_t> nextParent(0);
+		m_pool.Run([&](unsigned int thread)
+		{
+			Worker& worker = *m_workers[thread];
+			for (size_t i = nextParent++; i < m_layer.size(); i = nextParent++)
+			{
+				if (m_layer[i].next < m_numPieces)
+					Expand(m_layer[i], i, depth, worker);
+			}
+		});
+
+		m_layer.clear();
+		for (std::unique_ptr<Worker>& worker : m_workers)
+		{
+			m_layer.insert(m_layer.end(), worker->children.begin(), worker->children.end());
+			m_nodes += worker->nodes;
+			m_transpositions += worker->transpositions;
+		}
+
+		// Every piece tops out, go with the best board of the layer before.
+		if (m_layer.empty())
+			break;
+
+		if (m_layer.size() > m_beamWidth)
+		{
+			std::nth_element(m_layer.begin(), m_layer.begin() + m_beamWidth, m_layer.end(), IsBetter);
+			m_layer.resize(m_beamWidth);
+		}
+
+		// Sorted so the next layer's parents, and with them the orders of its children, don't depend on the threads.
+		std::sort(m_layer.begin(), m_layer.end(), IsBetter);
+		move = m_layer[0].first;
+		found = true;
+	}
+
+	return found;
+}
+
+bool BeamSearch::IsBetter(const Node& a, const Node& b)
+{
+	if (a.value != b.value)
+		return a.value > b.value;
+
+	return a.order < b.order;
+}
+
+void BeamSearch::Expand(const Node& parent, size_t index, unsigned int depth, Worker& worker)
+{
+	const PieceType current = m_sequence[parent.next];
+
+	// The first piece is already falling and may have moved, the rest start from where they spawn.
+	Node base = parent;
+	base.next = static_cast<uint8_t>(parent.next + 1);
+	base.order = static_cast<uint32_t>(index) * c_ORDERS_PER_PARENT;
+	AddChildren(base, depth == 0 ? m_piece : SpawnState(current, Playfield::c_NUM_COLS, *m_pieces), false, depth, worker);
+
+	if (depth == 0 && !m_canHold)
+		return;
+
+	// Holding swaps in the held piece, or the next one if nothing is held yet.
+	base.hold = current;
+	base.hasHold = true;
+	base.order += MoveGenerator::c_MAX_PLACEMENTS;
+
+	if (parent.hasHold)
+	{
+		if (parent.hold != current)
+			AddChildren(base, SpawnState(parent.hold, Playfield::c_NUM_COLS, *m_pieces), true, depth, worker);
+	}
+	else if (parent.next + 1u < m_numPieces)
+	{
+		base.next = static_cast<uint8_t>(parent.next + 2);
+		AddChildren(base, SpawnState(m_sequence[parent.next + 1], Playfield::c_NUM_COLS, *m_pieces), true, depth, worker);
+	}
+}
+
+void BeamSearch::AddChildren(const Node& base, const PieceState& piece, bool hold, unsigned int depth, Worker& worker)
+{
+	const unsigned int numPlacements = worker.generator.Generate(base.field, piece, *m_pieces, m_rule, worker.placements);
+
+	uint64_t baseKey = m_queueKeys[base.next] ^ m_layerKey;
+	if (base.hasHold)
+		baseKey ^= ZobristHoldKey(base.hold);
+
+	for (unsigned int i = 0; i < numPlacements; i++)
+	{
+		const Placement& placement = worker.placements[i];
+
+		Node child = base;
+		child.order = base.order + i;
+		if (depth == 0)
+			child.first = { hold, placement };
+
+		child.field.Place(placement.piece, *m_pieces);
+
+		// Combos and back-to-backs carry on as they do in the game.
+		ClearResult result = {};
+		result.lines = static_cast<uint8_t>(PopCount64(child.field.ClearFullRows()));
+		result.spin = placement.spin;
+
+		if (result.lines > 0)
+		{
+			result.combo = base.combo;
+			if (child.combo < 0xFF)
+				child.combo++;
+
+			const bool difficult = IsDifficultClear(result);
+			result.backToBack = difficult && base.backToBack;
+			child.backToBack = difficult;
+
+			child.score += m_weights.lineClear * result.lines + m_weights.attack * GetClearAttack(result);
+		}
+		else
+		{
+			child.combo = 0;
+		}
+
+		// Copies of a board only differ in the reward on the way there, keep the best.
+		const uint64_t key = baseKey ^ child.field.GetHash() ^ GetClearStateKey(child.combo, child.backToBack);
+		const uint64_t rank = PackRank(child.score, child.order);
+		uint64_t recorded;
+		if (m_table.Probe(key, recorded) && recorded >= rank)
+		{
+			worker.transpositions++;
+			continue;
+		}
+
+		m_table.Store(key, rank);
+
+		child.value = child.score + Evaluate(child.field, child.backToBack);
+		worker.children.push_back(child);
+		worker.nodes++;
+	}
+}
+
+float BeamSearch::Evaluate(const Playfield& field, bool backToBack) const
+{
+	const BoardFeatures features = ComputeFeatures(field);
+
+	float value = m_weights.aggregateHeight * features.aggregateHeight;
+	value += m_weights.maxHeight * features.maxHeight;
+	value += m_weights.bumpiness * features.bumpiness;
+	value += m_weights.holes * features.holes;
+	value += m_weights.coveredCells * features.coveredCells;
+	value += m_weights.rowTransitions * features.rowTransitions;
+	value += m_weights.columnTransitions * features.columnTransitions;
+	value += m_weights.wells * features.wells;
+	if (backToBack)
+		value += m_weights.backToBack;
+
+	return value;
+}
+
+// Taps are put in the middle of the tick, after the last update and before the next.
+static constexpr double c_TAP_OFFSET = 0.5 / Game::c_TICKS_PER_SECOND;
+
+BotController::BotController(unsigned int numThreads)
+	: m_search(numThreads)
+{
+	m_move = BotMove();
+	m_hasMove = false;
+	m_plannedHash = 0;
+	m_softDropHeld = false;
+	m_steps = 0;
+}
+
+BeamSearch& BotController::GetSearch()
+{
+	return m_search;
+}
+
+bool BotController::IsPlaying(const Game& game) const
+{
+	return game.HasActivePiece() && !game.IsGameOver();
+}
+
+void BotController::Update(const Game& game, InputHandler& input, double time)
+{
+	if (!IsPlaying(game))
+	{
+		HoldSoftDrop(input, false, time);
+		return;
+	}
+
+	GameState state;
+	game.SaveState(state);
+	const PieceSet& pieces = game.GetPieceSet();
+
+	// A new piece, a board changed by garbage or undo, or a hold that was refused all need a new plan.
+	const bool holdRefused = state.holdUsed && state.piece.type != m_move.placement.piece.type;
+	if (!m_hasMove || state.field.GetHash() != m_plannedHash || holdRefused)
+		Plan(state, pieces, game.GetSpinRule());
+
+	if (m_hasMove && m_move.hold && !state.holdUsed)
+	{
+		HoldSoftDrop(input, false, time);
+		Tap(input, InputAction::HOLD, time);
+		return;
+	}
+
+	InputAction action = InputAction::HARD_DROP;
+	const bool rotated = state.lastKick != c_NO_KICK;
+	const bool instantGravity = game.GetGravity() >= static_cast<double>(Game::c_GRAVITY_20G) / Game::c_GRAVITY_ONE_ROW;
+	if (m_hasMove && m_steps < c_MAX_STEPS && !FindNextAction(state.field, state.piece, rotated, instantGravity, m_move.placement, pieces, action))
+	{
+		// The piece was carried past the way there, e.g. by gravity, so plan again from where it is.
+		Plan(state, pieces, game.GetSpinRule());
+		if (m_hasMove && !FindNextAction(state.field, state.piece, rotated, instantGravity, m_move.placement, pieces, action))
+			action = InputAction::HARD_DROP;
+	}
+	m_steps++;
+
+	HoldSoftDrop(input, action == InputAction::SOFT_DROP, time);
+	if (action != InputAction::SOFT_DROP)
+		Tap(input, action, time);
+
+	// Nothing is planned for the next piece until it shows up.
+	if (action == InputAction::HARD_DROP)
+		m_hasMove = false;
+}
+
+void BotController::ReleaseKeys(InputHandler& input, double time)
+{
+	HoldSoftDrop(input, false, time);
+	m_hasMove = false;
+}
+
+void BotController::Plan(const GameState& state, const PieceSet& pieces, SpinRule rule)
+{
+	// Replanning the same piece keeps its count of steps.
+	if (!m_hasMove || state.field.GetHash() != m_plannedHash)
+		m_steps = 0;
+
+	m_hasMove = m_search.Search(state, pieces, rule, m_move);
+	m_plannedHash = state.field.GetHash();
+}
+
+void BotController::Tap(InputHandler& input, InputAction action, double time)
+{
+	input.Press(action, time - c_TAP_OFFSET);
+	input.Release(action, time - c_TAP_OFFSET);
+}
+
+void BotController::HoldSoftDrop(InputHandler& input, bool held, double time)
+{
+	if (held == m_softDropHeld)
+		return;
+
+	if (held)
+		input.Press(InputAction::SOFT_DROP, time - c_TAP_OFFSET);
+	else
+		input.Release(InputAction::SOFT_DROP, time - c_TAP_OFFSET);
+
+	m_softDropHeld = held;
+}
+
+// Turns the piece the way Game::RotatePiece does, with the first kick that fits.
+static bool Rotate(const Playfield& field, const PieceState& piece, int direction, const PieceSet& pieces, PieceState& rotated)
+{
+	const Kick* kicks = pieces.GetKicks(piece.type, piece.rotation, direction);
+
+	rotated = piece;
+	rotated.rotation = (piece.rotation + direction) & 3;
+
+	for (unsigned int i = 0; i < c_NUM_KICKS; i++)
+	{
+		rotated.x = piece.x + kicks[i].x;
+		rotated.y = piece.y - kicks[i].y;
+
+		if (!field.Collides(rotated, pieces))
+			return true;
+	}
+
+	return false;
+}
+
+bool BotController::FindNextAction(const Playfield& field, const PieceState& piece, bool rotated, bool instantGravity, const Placement& target, const PieceSet& pieces, InputAction& action)
+{
+	constexpr int c_OFFSET = MoveGenerator::c_OFFSET;
+	constexpr unsigned int c_NUM_X = MoveGenerator::c_NUM_X;
+	constexpr unsigned int c_NUM_Y = MoveGenerator::c_NUM_Y;
+	constexpr unsigned int c_NUM_STATES = c_NUM_ROTATIONS * c_NUM_X * c_NUM_Y;
+
+	const bool spin = target.spin != SpinType::NONE;
+	auto isTarget = [&](const PieceState& state, bool byRotation)
+	{
+		if (state.rotation != target.piece.rotation || state.x != target.piece.x)
+			return false;
+
+		if (spin)
+			return byRotation && state.y == target.piece.y;
+
+		return state.y + field.DropDistance(state, pieces) == target.piece.y;
+	};
+
+	if (isTarget(piece, rotated))
+	{
+		action = InputAction::HARD_DROP;
+		return true;
+	}
+
+	auto index = [&](const PieceState& state)
+	{
+		return (state.rotation * c_NUM_Y + (state.y + c_OFFSET)) * c_NUM_X + (state.x + c_OFFSET);
+	};
+
+	// Breadth first over where the piece can be, remembering the first step taken to get to each place.
+	static constexpr InputAction c_MOVES[] = { InputAction::LEFT, InputAction::RIGHT, InputAction::ROTATE_CW, InputAction::ROTATE_CCW, InputAction::SOFT_DROP };
+	bool visited[c_NUM_STATES] = {};
+	PieceState queue[c_NUM_STATES];
+	InputAction firstMove[c_NUM_STATES];
+	unsigned int head = 0;
+	unsigned int tail = 0;
+
+	visited[index(piece)] = true;
+	queue[tail++] = piece;
+
+	while (head < tail)
+	{
+		const PieceState from = queue[head++];
+
+		for (InputAction move : c_MOVES)
+		{
+			PieceState to = from;
+			bool moved;
+			switch (move)
+			{
+			case InputAction::LEFT:
+			case InputAction::RIGHT:
+				to.x += move == InputAction::LEFT ? -1 : 1;
+				moved = !field.Collides(to, pieces);
+				break;
+			case InputAction::SOFT_DROP:
+				to.y++;
+				moved = !field.Collides(to, pieces);
+				break;
+			default:
+				moved = Rotate(field, from, move == InputAction::ROTATE_CW ? 1 : -1, pieces, to);
+				break;
+			}
+
+			if (!moved)
+				continue;
+
+			// Landing keeps the last kick, so a rotation that lands the piece still counts for a spin.
+			if (instantGravity)
+				to.y += field.DropDistance(to, pieces);
+
+			const InputAction first = head == 1 ? move : firstMove[index(from)];
+			const bool byRotation = move == InputAction::ROTATE_CW || move == InputAction::ROTATE_CCW;
+			if (isTarget(to, byRotation))
+			{
+				action = first;
+				return true;
+			}
+
+			const unsigned int i = index(to);
+			if (visited[i])
+				continue;
+
+			visited[i] = true;
+			firstMove[i] = first;
+			queue[tail++] = to;
+		}
+	}
+
+	return false;
+}
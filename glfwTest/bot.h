@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "game.h"
+#include "input.h"
+#include "movegen.h"
+#include "eval.h"
+#include "threadpool.h"
+#include "transposition.h"
+
+/*
+	How much the bot cares about each feature of a board (see BoardFeatures),
+	negative for the ones it should keep low, and about the clears on the way to
+	it. A board is worth the clear rewards so far plus the weighted features.
+*/
+struct BotWeights
+{
+	float aggregateHeight;
+	float maxHeight;
+	float bumpiness;
+	float holes;
+	float coveredCells;
+	float rowTransitions;
+	float columnTransitions;
+	float wells;
+	float lineClear;  // For each line cleared
+	float attack;     // For each garbage row a clear is worth
+	float backToBack; // For a board that keeps a back-to-back chain going
+};
+
+inline constexpr BotWeights c_DEFAULT_BOT_WEIGHTS = { -0.5f, -1.0f, -0.3f, -6.0f, -0.5f, -0.4f, -1.0f, -0.3f, 0.5f, 2.0f, 1.0f };
+
+// What the bot will do with the falling piece: hold it or not, then lock the piece at placement.
+struct BotMove
+{
+	bool hold;
+	Placement placement;
+};
+
+/*
+	Picks placements by beam search over the known pieces: the falling piece, the
+	queue and hold. Every board in a layer is expanded by placing the next piece,
+	or the held one, everywhere it can go, the children are scored, and the best
+	c_DEFAULT_BEAM_WIDTH go on to the next layer. The move chosen is the first
+	move on the way to the best board in the last layer.
+
+	Each layer is split between the threads of a pool, every thread having its
+	own move generator, placement buffer and list of children that are reused
+	from layer to layer and search to search, so a search allocates nothing once
+	the buffers have grown. Clears are modelled without cascade gravity.
+
+	The same board is often reached by placing pieces in another order or
+	through hold. All the threads share a transposition table keyed by the board
+	hash, the pieces still to come and the combo and back-to-back, where each
+	child records its reward. A child that finds an equal or better one of itself
+	there is dropped before it is evaluated, so the beam isn't filled with copies.
+	With more than one thread, which worse copies slip through before the better
+	one is recorded can vary from run to run, and with it the move in rare ties.
+*/
+class BeamSearch
+{
+public:
+	static constexpr unsigned int c_DEFAULT_BEAM_WIDTH = 200;
+	static constexpr unsigned int c_MAX_BEAM_WIDTH = 1u << 20;
+	static constexpr size_t c_DEFAULT_TABLE_BYTES = 1u << 20; // Room for a few layers of the default beam while staying in cache
+
+	// 0 threads means one per hardware thread.
+	explicit BeamSearch(unsigned int numThreads = 0, size_t tableBytes = c_DEFAULT_TABLE_BYTES);
+
+	void SetWeights(const BotWeights& weights);
+	const BotWeights& GetWeights() const;
+
+	// Boards kept from each layer, 1 - c_MAX_BEAM_WIDTH.
+	void SetBeamWidth(unsigned int width);
+
+	// Pieces placed ahead, limited by how many are known.
+	void SetMaxDepth(unsigned int depth);
+
+	/*
+		Works out the move for the falling piece of the game. Returns false if the
+		game has no falling piece or it can't be placed anywhere.
+	*/
+	bool Search(const GameState& state, const PieceSet& pieces, SpinRule rule, BotMove& move);
+
+	// Boards scored by the last search, and boards it dropped as copies of ones already reached.
+	uint64_t GetNodeCount() const;
+	uint64_t GetTranspositionCount() const;
+
+private:
+	struct Node
+	{
+		Playfield field;
+		float score; // Reward for the clears on the way here
+		float value; // score plus what the board itself is worth, what the beam is ranked by
+		uint32_t order; // Where the node came from, to rank equal values the same way however the threads ran
+		BotMove first;
+		uint8_t next; // Index in m_sequence of the piece to place next
+		PieceType hold;
+		bool hasHold;
+		uint8_t combo;
+		bool backToBack;
+	};
+
+	// Scratch space for one thread.
+	struct Worker
+	{
+		MoveGenerator generator;
+		Placement placements[MoveGenerator::c_MAX_PLACEMENTS];
+		std::vector<Node> children;
+		uint64_t nodes;
+		uint64_t transpositions;
+	};
+
+	static bool IsBetter(const Node& a, const Node& b);
+
+	void Expand(const Node& parent, size_t index, unsigned int depth, Worker& worker);
+	void AddChildren(const Node& base, const PieceState& piece, bool hold, unsigned int depth, Worker& worker);
+	float Evaluate(const Playfield& field, bool backToBack) const;
+
+	ThreadPool m_pool;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	TranspositionTable m_table;
+	uint64_t m_numLayers; // Layers searched so far, each gets its own table keys
+	BotWeights m_weights;
+	unsigned int m_beamWidth;
+	unsigned int m_maxDepth;
+
+	// Set up for the search under way.
+	const PieceSet* m_pieces;
+	SpinRule m_rule;
+	PieceState m_piece; // The falling piece where it is now
+	bool m_canHold;     // Whether the falling piece can still be held
+	PieceType m_sequence[PieceQueue::c_MAX_DEPTH + 1]; // The falling piece then the queue
+	unsigned int m_numPieces;
+	uint64_t m_queueKeys[PieceQueue::c_MAX_DEPTH + 2]; // Hash of the pieces still to come for each index in m_sequence
+	uint64_t m_layerKey; // XORed into the keys of the layer being expanded, so earlier layers and searches never match
+
+	std::vector<Node> m_layer;
+	uint64_t m_nodes;
+	uint64_t m_transpositions;
+};
+
+/*
+	Plays a game through an InputHandler with the same presses and releases a
+	player's keys make. A move is planned with a beam search whenever a new piece
+	or a changed board shows up, then each tick the shortest way from where the
+	piece is to the planned placement is worked out again and its first step is
+	taken, so gravity or a missed input can't throw the bot off course. Shifts
+	and rotations are tapped once per tick, soft drop is held for as long as the
+	piece has to go down a row at a time, and the piece is hard dropped as soon
+	as it would land in place.
+*/
+class BotController
+{
+public:
+	// Gravity or lock delay can send a piece round in circles, e.g. kicked up and pulled back down, so it gets this many steps.
+	static constexpr unsigned int c_MAX_STEPS = 60;
+
+	explicit BotController(unsigned int numThreads = 0);
+
+	BeamSearch& GetSearch();
+
+	// Presses the keys for this tick, time being when the tick ends. Call before the input handler is updated to time.
+	void Update(const Game& game, InputHandler& input, double time);
+
+	// Lets go of any key still held, e.g. before handing the game back to the player.
+	void ReleaseKeys(InputHandler& input, double time);
+
+	// True while the bot has a piece to move, when it wants Update called every tick.
+	bool IsPlaying(const Game& game) const;
+
+private:
+	void Plan(const GameState& state, const PieceSet& pieces, SpinRule rule);
+	void Tap(InputHandler& input, InputAction action, double time);
+	void HoldSoftDrop(InputHandler& input, bool held, double time);
+
+	/*
+		First step of the shortest way from piece to a spot that hard drops to
+		target, false if there is none. A spin has to end with a rotation into
+		place, rotated being whether the piece's last move already was one. With
+		instant gravity the piece lands after every move, as it does at 20G.
+	*/
+	static bool FindNextAction(const Playfield& field, const PieceState& piece, bool rotated, bool instantGravity, const Placement& target, const PieceSet& pieces, InputAction& action);
+
+	BeamSearch m_search;
+	BotMove m_move;
+	bool m_hasMove;
+	uint64_t m_plannedHash; // Hash of the playfield the move was planned on
+	bool m_softDropHeld;
+	unsigned int m_steps; // Steps taken with the piece, a piece that is never reached is dropped after c_MAX_STEPS
+};
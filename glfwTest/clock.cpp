@@ -0,0 +1,43 @@
+#include "clock.h"
+
+FixedStepClock::FixedStepClock(unsigned int ticksPerSecond)
+{
+	m_tickLength = 1.0 / ticksPerSecond;
+	m_accumulator = 0.0;
+}
+
+unsigned int FixedStepClock::Advance(double elapsedSeconds, unsigned int idleTicks)
+{
+	if (elapsedSeconds > 0.0)
+		m_accumulator += elapsedSeconds;
+
+	const unsigned int maxTicks = c_MAX_TICKS_PER_ADVANCE + idleTicks;
+
+	unsigned int ticks = 0;
+	while (m_accumulator >= m_tickLength && ticks < maxTicks)
+	{
+		m_accumulator -= m_tickLength;
+		ticks++;
+	}
+
+	// Drop the time we could not catch up on.
+	if (ticks == maxTicks && m_accumulator > m_tickLength)
+		m_accumulator = 0.0;
+
+	return ticks;
+}
+
+double FixedStepClock::GetAlpha() const
+{
+	return m_accumulator / m_tickLength;
+}
+
+double FixedStepClock::GetTickLength() const
+{
+	return m_tickLength;
+}
+
+double FixedStepClock::GetTimeUntil(unsigned int ticks) const
+{
+	return ticks * m_tickLength - m_accumulator;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+/*
+	Turns elapsed real time into a whole number of fixed simulation ticks. The host
+	feeds it whatever clock it has, e.g. glfwGetTime(), and runs that many ticks;
+	the remainder is carried over to the next call so no time is lost.
+*/
+class FixedStepClock
+{
+public:
+	FixedStepClock(unsigned int ticksPerSecond);
+
+	/*
+		Returns the number of ticks to run for elapsedSeconds of real time. idleTicks
+		are ticks the host chose to sleep through rather than run as they came due,
+		they are allowed on top of the limit on catching up after a stall.
+	*/
+	unsigned int Advance(double elapsedSeconds, unsigned int idleTicks = 0);
+
+	// Fraction of a tick that has built up but not been run yet, 0 - 1.
+	double GetAlpha() const;
+
+	// Seconds from now until ticks more ticks are due.
+	double GetTimeUntil(unsigned int ticks) const;
+
+	double GetTickLength() const;
+
+private:
+	// Stops a long stall (e.g. dragging the window) from running hundreds of ticks at once.
+	static constexpr unsigned int c_MAX_TICKS_PER_ADVANCE = 10;
+
+	double m_tickLength;
+	double m_accumulator;
+};
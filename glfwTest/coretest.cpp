@@ -0,0 +1,580 @@
+// coretest.cpp : Checks parts of the rules library against simple reference versions.
+//
+// Usage: coretest <check> [piece set file...]
+//
+// Each check plays out random positions two ways, the optimized way the game
+// does it and a slow, obviously right way written out cell by cell, and fails
+// on the first position where they differ. Run by CTest, one test per check.
+// Checks that place pieces use the standard pieces and any sets given.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "game.h"
+#include "movegen.h"
+#include "piece.h"
+#include "playfield.h"
+#include "randomizer.h"
+#include "spin.h"
+
+/*
+	A board as one bool per cell, for the reference versions to work on without
+	any of the row mask tricks they are checking.
+*/
+template <unsigned int Cols, unsigned int Rows>
+using Grid = std::array<std::array<bool, Cols>, Rows>;
+
+template <unsigned int Cols, unsigned int Rows>
+static Grid<Cols, Rows> ToGrid(const BasicPlayfield<Cols, Rows>& field)
+{
+	Grid<Cols, Rows> grid;
+	for (unsigned int row = 0; row < Rows; row++)
+	{
+		for (unsigned int col = 0; col < Cols; col++)
+		{
+			grid[row][col] = field.IsOccupied(row, col);
+		}
+	}
+
+	return grid;
+}
+
+// Random blocks up to a random height, some rows full, so that clusters float and falls fill rows.
+template <unsigned int Cols, unsigned int Rows>
+static BasicPlayfield<Cols, Rows> MakeRandomStack(Xoshiro128& rng, unsigned int maxHeight = Rows)
+{
+	BasicPlayfield<Cols, Rows> field;
+	const unsigned int height = 1 + rng.NextBelow(maxHeight);
+	const uint32_t density = 30 + rng.NextBelow(50);
+
+	for (unsigned int row = Rows - height; row < Rows; row++)
+	{
+		const bool full = rng.NextBelow(100) < 10;
+		for (unsigned int col = 0; col < Cols; col++)
+		{
+			if (full || rng.NextBelow(100) < density)
+				field.SetOccupied(row, col);
+		}
+	}
+
+	return field;
+}
+
+/*
+	Cascade gravity one cell at a time: clusters are found by breadth first
+	search, in the order Playfield::SettleClusters takes them (by lowest row,
+	bottom first, then by leftmost block of that row), and each falls a row at a
+	time. Passes repeat until nothing moves, then full rows are cleared and it
+	starts again until a fall clears nothing. Returns the rows cleared.
+*/
+template <unsigned int Cols, unsigned int Rows>
+static unsigned int ReferenceCascade(Grid<Cols, Rows>& grid)
+{
+	unsigned int cleared = 0;
+	while (true)
+	{
+		bool anyFell = false;
+		bool fell = true;
+		while (fell)
+		{
+			fell = false;
+
+			// Everything joined to the floor stays put.
+			Grid<Cols, Rows> settled = {};
+			std::array<Cell, Rows * Cols> queue;
+			unsigned int head = 0;
+			unsigned int tail = 0;
+			for (unsigned int col = 0; col < Cols; col++)
+			{
+				if (grid[Rows - 1][col])
+				{
+					settled[Rows - 1][col] = true;
+					queue[tail++] = { static_cast<int>(Rows) - 1, static_cast<int>(col) };
+				}
+			}
+
+			auto spread = [&](Grid<Cols, Rows>& seen, const Grid<Cols, Rows>& blocks)
+			{
+				static constexpr int c_STEPS[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+				while (head < tail)
+				{
+					const Cell block = queue[head++];
+					for (const auto& step : c_STEPS)
+					{
+						const int row = block.row + step[0];
+						const int col = block.col + step[1];
+						if (row < 0 || row >= static_cast<int>(Rows) || col < 0 || col >= static_cast<int>(Cols))
+							continue;
+						if (!blocks[row][col] || seen[row][col])
+							continue;
+
+						seen[row][col] = true;
+						queue[tail++] = { row, col };
+					}
+				}
+			};
+			spread(settled, grid);
+
+			Grid<Cols, Rows> floating = {};
+			for (unsigned int row = 0; row < Rows; row++)
+			{
+				for (unsigned int col = 0; col < Cols; col++)
+				{
+					floating[row][col] = grid[row][col] && !settled[row][col];
+				}
+			}
+
+			for (int seedRow = static_cast<int>(Rows) - 1; seedRow >= 0; seedRow--)
+			{
+				for (int seedCol = 0; seedCol < static_cast<int>(Cols); seedCol++)
+				{
+					if (!floating[seedRow][seedCol])
+						continue;
+
+					Grid<Cols, Rows> cluster = {};
+					cluster[seedRow][seedCol] = true;
+					head = 0;
+					tail = 0;
+					queue[tail++] = { seedRow, seedCol };
+					spread(cluster, floating);
+
+					// Lift the cluster off the board, see how far it can fall, and put it back there.
+					const unsigned int size = tail;
+					for (unsigned int i = 0; i < size; i++)
+					{
+						floating[queue[i].row][queue[i].col] = false;
+						grid[queue[i].row][queue[i].col] = false;
+					}
+
+					int distance = 0;
+					bool fits = true;
+					while (fits)
+					{
+						for (unsigned int i = 0; i < size && fits; i++)
+						{
+							const int row = queue[i].row + distance + 1;
+							fits = row < static_cast<int>(Rows) && !grid[row][queue[i].col];
+						}
+						if (fits)
+							distance++;
+					}
+
+					for (unsigned int i = 0; i < size; i++)
+					{
+						grid[queue[i].row + distance][queue[i].col] = true;
+					}
+					fell |= distance > 0;
+				}
+			}
+
+			anyFell |= fell;
+		}
+
+		if (!anyFell)
+			return cleared;
+
+		unsigned int dest = Rows;
+		unsigned int full = 0;
+		for (unsigned int row = Rows; row-- > 0;)
+		{
+			bool isFull = true;
+			for (unsigned int col = 0; col < Cols; col++)
+			{
+				isFull &= grid[row][col];
+			}
+
+			if (isFull)
+				full++;
+			else
+				grid[--dest] = grid[row];
+		}
+		while (dest > 0)
+		{
+			grid[--dest] = {};
+		}
+
+		if (full == 0)
+			return cleared;
+		cleared += full;
+	}
+}
+
+template <unsigned int Cols, unsigned int Rows>
+static bool CheckCascadeOn(unsigned int numBoards, uint64_t seed)
+{
+	Xoshiro128 rng;
+	rng.Seed(seed);
+
+	for (unsigned int i = 0; i < numBoards; i++)
+	{
+		BasicPlayfield<Cols, Rows> field = MakeRandomStack<Cols, Rows>(rng);
+		Grid<Cols, Rows> grid = ToGrid(field);
+
+		const unsigned int cleared = field.Cascade();
+		const unsigned int expected = ReferenceCascade<Cols, Rows>(grid);
+
+		if (cleared != expected || ToGrid(field) != grid || field.GetHash() != field.ComputeHash())
+		{
+			std::cout << Cols << "x" << Rows << " board " << i << " of seed " << seed << " differs, cascade cleared " << cleared << " rows and the reference " << expected << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Playfield::Cascade against the cell by cell version, on every board size the game uses.
+static bool CheckCascade(const std::vector<PieceSet>& /*pieceSets*/)
+{
+	return CheckCascadeOn<10, 20>(20000, 1) && CheckCascadeOn<10, 40>(5000, 2) && CheckCascadeOn<64, 20>(2000, 3);
+}
+
+// Everything in two game states that play can change, field by field so padding doesn't count.
+static bool IsSameState(const GameState& a, const GameState& b)
+{
+	if (a.field.GetRows() != b.field.GetRows() || a.field.GetHash() != b.field.GetHash())
+		return false;
+
+	if (a.activePiece != b.activePiece || a.gameOver != b.gameOver || a.lines != b.lines || a.level != b.level)
+		return false;
+
+	if (a.activePiece && (a.piece.type != b.piece.type || a.piece.rotation != b.piece.rotation || a.piece.x != b.piece.x || a.piece.y != b.piece.y))
+		return false;
+
+	if (std::memcmp(a.random.rng.state, b.random.rng.state, sizeof(a.random.rng.state)) != 0 || std::memcmp(a.random.data, b.random.data, sizeof(a.random.data)) != 0)
+		return false;
+
+	if (a.queue.count != b.queue.count || a.queue.depth != b.queue.depth)
+		return false;
+	for (unsigned int i = 0; i < a.queue.count; i++)
+	{
+		if (a.queue[i] != b.queue[i])
+			return false;
+	}
+
+	if (a.hasHold != b.hasHold || (a.hasHold && a.hold != b.hold) || a.holdUsed != b.holdUsed)
+		return false;
+
+	if (a.gravityRows != b.gravityRows || a.lockTimer != b.lockTimer || a.lockResets != b.lockResets || a.lowestRow != b.lowestRow || a.lastKick != b.lastKick)
+		return false;
+
+	const ClearResult& clearA = a.lastClear;
+	const ClearResult& clearB = b.lastClear;
+	if (clearA.lines != clearB.lines || clearA.spin != clearB.spin || clearA.combo != clearB.combo || clearA.backToBack != clearB.backToBack
+		|| clearA.attack != clearB.attack || clearA.sent != clearB.sent)
+		return false;
+
+	if (a.score != b.score || a.combo != b.combo || a.backToBack != b.backToBack || a.tick != b.tick)
+		return false;
+
+	if (a.garbage.count != b.garbage.count)
+		return false;
+	for (unsigned int i = 0; i < a.garbage.count; i++)
+	{
+		const GarbageQueue::Entry& entryA = a.garbage.entries[(a.garbage.head + i) % GarbageQueue::c_CAPACITY];
+		const GarbageQueue::Entry& entryB = b.garbage.entries[(b.garbage.head + i) % GarbageQueue::c_CAPACITY];
+		if (entryA.lines != entryB.lines || entryA.holeCol != entryB.holeCol || entryA.timer != entryB.timer)
+			return false;
+	}
+
+	return true;
+}
+
+// Game::Tick(ticks), which skips the idle ticks in one go, against ticking one at a time, over random games at every level.
+static bool CheckTicks(const std::vector<PieceSet>& /*pieceSets*/)
+{
+	Xoshiro128 rng;
+	rng.Seed(4);
+
+	for (unsigned int i = 0; i < 4000; i++)
+	{
+		const unsigned int level = 1 + rng.NextBelow(Game::c_MAX_LEVEL);
+		const bool cascade = rng.NextBelow(4) == 0;
+
+		Game stepped;
+		Game skipped;
+		for (Game* game : { &stepped, &skipped })
+		{
+			game->SetStartLevel(level);
+			game->SetCascadeGravity(cascade);
+			game->Seed(i);
+		}
+
+		for (unsigned int step = 0; step < 1000 && !stepped.IsGameOver(); step++)
+		{
+			// The same input to both games, then idle for anything from a tick to several seconds.
+			const unsigned int action = rng.NextBelow(10);
+			const int shift = static_cast<int>(rng.NextBelow(9)) - 4;
+			const unsigned int lines = 1 + rng.NextBelow(4);
+			const unsigned int holeCol = rng.NextBelow(Playfield::c_NUM_COLS);
+			for (Game* game : { &stepped, &skipped })
+			{
+				switch (action)
+				{
+				case 0: case 1: game->MovePiece(shift, 0); break;
+				case 2: game->RotatePiece(1); break;
+				case 3: game->RotatePiece(-1); break;
+				case 4: game->DropPiece(1); break;
+				case 5: game->HardDrop(); break;
+				case 6: game->HoldPiece(); break;
+				case 7: game->ReceiveGarbage(lines, holeCol); break;
+				default: break;
+				}
+			}
+
+			// Mostly a few ticks, so pieces get moved around, sometimes long enough for gravity and lock delays to run out.
+			const unsigned int ticks = 1 + rng.NextBelow(rng.NextBelow(4) == 0 ? 240 : 8);
+			for (unsigned int t = 0; t < ticks; t++)
+			{
+				stepped.Tick();
+			}
+			skipped.Tick(ticks);
+
+			GameState a;
+			GameState b;
+			stepped.SaveState(a);
+			skipped.SaveState(b);
+			if (!IsSameState(a, b))
+			{
+				std::cout << "Game " << i << " at level " << level << " differs after step " << step << ", " << ticks << " ticks" << std::endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// The cells a placement covers, in order, so placements of the same blocks compare equal whatever the rotation.
+using PlacementCells = std::vector<int>;
+
+template <unsigned int Cols>
+static PlacementCells GetPlacementCells(const PieceState& piece, const PieceSet& pieces)
+{
+	Cell cells[c_MAX_PIECE_BLOCKS];
+	const unsigned int numCells = GetPieceCells(piece, cells, pieces);
+
+	PlacementCells placement;
+	for (unsigned int i = 0; i < numCells; i++)
+	{
+		placement.push_back(cells[i].row * static_cast<int>(Cols) + cells[i].col);
+	}
+	std::sort(placement.begin(), placement.end());
+
+	return placement;
+}
+
+/*
+	Every placement by breadth first search over single (rotation, x, y) states,
+	moving the piece with Collides and the first kick that fits the way
+	Game::RotatePiece does. A state the piece can't drop from is a placement,
+	scoring the best spin DetectSpin gives for any of the kicks that rotated the
+	piece into it. Placements of the same cells keep the better spin.
+*/
+template <unsigned int Cols, unsigned int Rows>
+static std::map<PlacementCells, SpinType> ReferencePlacements(const BasicPlayfield<Cols, Rows>& field, const PieceState& start, const PieceSet& pieces, SpinRule rule)
+{
+	constexpr int c_OFFSET = c_MAX_BOX_SIZE - 1;
+	constexpr int c_NUM_X = Cols + c_OFFSET;
+	constexpr int c_NUM_Y = Rows + c_OFFSET;
+
+	std::map<PlacementCells, SpinType> placements;
+	if (field.Collides(start, pieces))
+		return placements;
+
+	auto index = [&](const PieceState& piece)
+	{
+		return (piece.rotation * c_NUM_Y + piece.y + c_OFFSET) * c_NUM_X + piece.x + c_OFFSET;
+	};
+
+	// Bit i of kicks is set for a state reached by a rotation with kick i.
+	std::vector<bool> visited(c_NUM_ROTATIONS * c_NUM_X * c_NUM_Y, false);
+	std::vector<uint8_t> kicks(visited.size(), 0);
+	std::vector<PieceState> queue;
+
+	visited[index(start)] = true;
+	queue.push_back(start);
+
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		const PieceState from = queue[head];
+
+		for (int move = 0; move < 5; move++)
+		{
+			PieceState to = from;
+			int kick = -1;
+			if (move < 2)
+			{
+				to.x += move == 0 ? -1 : 1;
+			}
+			else if (move == 2)
+			{
+				to.y++;
+			}
+			else
+			{
+				const int direction = move == 3 ? 1 : -1;
+				const Kick* rotationKicks = pieces.GetKicks(from.type, from.rotation, direction);
+				to.rotation = (from.rotation + direction) & 3;
+				for (unsigned int i = 0; i < c_NUM_KICKS && kick < 0; i++)
+				{
+					to.x = from.x + rotationKicks[i].x;
+					to.y = from.y - rotationKicks[i].y;
+					if (!field.Collides(to, pieces))
+						kick = static_cast<int>(i);
+				}
+				if (kick < 0)
+					continue;
+			}
+
+			if (field.Collides(to, pieces))
+				continue;
+
+			const int i = index(to);
+			if (kick >= 0)
+				kicks[i] |= static_cast<uint8_t>(1u << kick);
+			if (!visited[i])
+			{
+				visited[i] = true;
+				queue.push_back(to);
+			}
+		}
+	}
+
+	for (const PieceState& piece : queue)
+	{
+		PieceState dropped = piece;
+		dropped.y++;
+		if (!field.Collides(dropped, pieces))
+			continue;
+
+		SpinType spin = SpinType::NONE;
+		for (unsigned int kick = 0; kick < c_NUM_KICKS; kick++)
+		{
+			if (kicks[index(piece)] & (1u << kick))
+				spin = std::max(spin, DetectSpin(field, piece, static_cast<uint8_t>(kick), pieces, rule));
+		}
+
+		const PlacementCells cells = GetPlacementCells<Cols>(piece, pieces);
+		auto found = placements.find(cells);
+		if (found == placements.end())
+			placements[cells] = spin;
+		else
+			found->second = std::max(found->second, spin);
+	}
+
+	return placements;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+static bool CheckMoveGeneratorOn(const PieceSet& pieces, unsigned int numBoards, uint64_t seed)
+{
+	Xoshiro128 rng;
+	rng.Seed(seed);
+
+	std::unique_ptr<BasicMoveGenerator<Cols, Rows>> generator(new BasicMoveGenerator<Cols, Rows>());
+	std::vector<Placement> generated(BasicMoveGenerator<Cols, Rows>::c_MAX_PLACEMENTS);
+
+	for (unsigned int i = 0; i < numBoards; i++)
+	{
+		// Low enough for most pieces to fit where they spawn, ragged enough for kicks and spins.
+		BasicPlayfield<Cols, Rows> field = MakeRandomStack<Cols, Rows>(rng, Rows * 3 / 4);
+		field.ClearFullRows();
+
+		const PieceType type = static_cast<PieceType>(rng.NextBelow(pieces.numTypes));
+		const SpinRule rule = rng.NextBelow(2) == 0 ? SpinRule::T_SPIN : SpinRule::ALL_SPIN;
+
+		// Some searches start from a piece already moved off its spawn column.
+		PieceState start = SpawnState(type, Cols, pieces);
+		PieceState moved = start;
+		moved.x = static_cast<int8_t>(moved.x + static_cast<int>(rng.NextBelow(7)) - 3);
+		if (!field.Collides(moved, pieces))
+			start = moved;
+
+		const unsigned int numGenerated = generator->Generate(field, start, pieces, rule, generated.data());
+		std::map<PlacementCells, SpinType> found;
+		bool duplicate = false;
+		for (unsigned int p = 0; p < numGenerated; p++)
+		{
+			duplicate |= !found.emplace(GetPlacementCells<Cols>(generated[p].piece, pieces), generated[p].spin).second;
+		}
+
+		const std::map<PlacementCells, SpinType> expected = ReferencePlacements(field, start, pieces, rule);
+		if (duplicate || found != expected)
+		{
+			std::cout << Cols << "x" << Rows << " board " << i << " of seed " << seed << ", piece " << PieceName(type, pieces) << ": generated " << numGenerated
+				<< " placements" << (duplicate ? " with duplicates" : "") << ", the reference " << expected.size() << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// MoveGenerator against a search of one state at a time, on the standard and tall boards with every piece set.
+static bool CheckMoveGenerator(const std::vector<PieceSet>& pieceSets)
+{
+	for (size_t i = 0; i < pieceSets.size(); i++)
+	{
+		if (!CheckMoveGeneratorOn<10, 20>(pieceSets[i], 3000, 5 + i) || !CheckMoveGeneratorOn<10, 40>(pieceSets[i], 500, 50 + i))
+			return false;
+	}
+
+	return true;
+}
+
+struct Check
+{
+	const char* name;
+	bool (*run)(const std::vector<PieceSet>& pieceSets);
+};
+
+static const Check c_CHECKS[] =
+{
+	{ "cascade", CheckCascade },
+	{ "ticks", CheckTicks },
+	{ "movegen", CheckMoveGenerator },
+};
+
+int main(int argc, char** argv)
+{
+	std::vector<PieceSet> pieceSets(1, c_STANDARD_PIECES);
+	for (int i = 2; i < argc; i++)
+	{
+		try
+		{
+			pieceSets.push_back(PieceSet::Load(argv[i]));
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (const Check& check : c_CHECKS)
+	{
+		if (argc < 2 || std::strcmp(argv[1], check.name) != 0)
+			continue;
+
+		const bool passed = check.run(pieceSets);
+		std::cout << check.name << (passed ? " passed" : " FAILED") << std::endl;
+		return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	std::cerr << "Usage: coretest <check> [piece set file...], the check one of:";
+	for (const Check& check : c_CHECKS)
+	{
+		std::cerr << " " << check.name;
+	}
+	std::cerr << std::endl;
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,270 @@
+#include "eval.h"
+#include "bits.h"
+
+// SSE2 is part of x86-64, so it needs no compiler flags there.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EVAL_SSE2
+#include <emmintrin.h>
+#endif
+
+static constexpr unsigned int c_COLS = Playfield::c_NUM_COLS;
+static constexpr unsigned int c_ROWS = Playfield::c_NUM_ROWS;
+static constexpr unsigned int c_PADDED_ROWS = 24; // Three registers of eight rows, the rows past the bottom being full
+
+static constexpr uint16_t c_FULL = Playfield::c_FULL_ROW;
+static constexpr uint16_t c_LEFT_WALL = 1;
+static constexpr uint16_t c_RIGHT_WALL = 1 << (c_COLS - 1);
+
+// A row shifted up one bit with a filled wall either side, and the pairs of neighbours in it.
+static constexpr uint16_t c_WALLS = 1 | (1 << (c_COLS + 1));
+static constexpr uint16_t c_NEIGHBOURS = (1 << (c_COLS + 1)) - 1;
+
+static_assert(c_COLS + 2 <= 16, "Rows with a wall either side must fit in 16 bits");
+static_assert(c_ROWS < c_PADDED_ROWS, "The board must fit in three registers with a floor row below");
+
+#ifdef EVAL_SSE2
+using RowBlock = __m128i[3];
+
+// Every lane set to the last or the first row of x.
+static inline __m128i BroadcastLast(__m128i x)
+{
+	x = _mm_shufflehi_epi16(x, 0xFF);
+	return _mm_unpackhi_epi64(x, x);
+}
+
+static inline __m128i BroadcastFirst(__m128i x)
+{
+	x = _mm_shufflelo_epi16(x, 0x00);
+	return _mm_unpacklo_epi64(x, x);
+}
+
+// Each row replaced by the one above it, empty for the top row.
+static inline void ShiftDown(const RowBlock rows, RowBlock shifted)
+{
+	shifted[2] = _mm_or_si128(_mm_slli_si128(rows[2], 2), _mm_srli_si128(rows[1], 14));
+	shifted[1] = _mm_or_si128(_mm_slli_si128(rows[1], 2), _mm_srli_si128(rows[0], 14));
+	shifted[0] = _mm_slli_si128(rows[0], 2);
+}
+
+// Counts the bits of each byte by halves, then adds up the bytes of all three registers at once.
+static inline unsigned int CountCells(const RowBlock rows)
+{
+	const __m128i ones = _mm_set1_epi8(0x55);
+	const __m128i pairs = _mm_set1_epi8(0x33);
+	const __m128i nibbles = _mm_set1_epi8(0x0F);
+
+	__m128i total = _mm_setzero_si128();
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		__m128i x = rows[i];
+		x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi16(x, 1), ones));
+		x = _mm_add_epi8(_mm_and_si128(x, pairs), _mm_and_si128(_mm_srli_epi16(x, 2), pairs));
+		x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi16(x, 4)), nibbles);
+		total = _mm_add_epi8(total, x);
+	}
+
+	total = _mm_sad_epu8(total, _mm_setzero_si128());
+	return static_cast<unsigned int>(_mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+}
+
+static void ComputeCellFeatures(const uint16_t* paddedRows, BoardFeatures& features)
+{
+	const __m128i full = _mm_set1_epi16(c_FULL);
+
+	RowBlock rows;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		rows[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(paddedRows) + i);
+	}
+
+	// The cells with a block anywhere above them: OR every row into the ones below,
+	// within a register by doubling shifts, then from each register into the next.
+	RowBlock blocked;
+	__m128i above = _mm_setzero_si128();
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		__m128i x = rows[i];
+		x = _mm_or_si128(x, _mm_slli_si128(x, 2));
+		x = _mm_or_si128(x, _mm_slli_si128(x, 4));
+		x = _mm_or_si128(x, _mm_slli_si128(x, 8));
+		blocked[i] = _mm_or_si128(x, above);
+		above = BroadcastLast(blocked[i]);
+	}
+
+	RowBlock covered;
+	ShiftDown(blocked, covered);
+
+	RowBlock holes;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		holes[i] = _mm_andnot_si128(rows[i], covered[i]);
+	}
+
+	// And the same for holes from the bottom up, to find the blocks over them.
+	RowBlock overHoles;
+	__m128i below = _mm_setzero_si128();
+	for (unsigned int i = 3; i-- > 0;)
+	{
+		__m128i x = holes[i];
+		x = _mm_or_si128(x, _mm_srli_si128(x, 2));
+		x = _mm_or_si128(x, _mm_srli_si128(x, 4));
+		x = _mm_or_si128(x, _mm_srli_si128(x, 8));
+		x = _mm_or_si128(x, below);
+		overHoles[i] = _mm_and_si128(rows[i], x);
+		below = BroadcastFirst(x);
+	}
+
+	RowBlock upper;
+	ShiftDown(rows, upper);
+
+	RowBlock rowChanges;
+	RowBlock columnChanges;
+	RowBlock wells;
+	const __m128i walls = _mm_set1_epi16(c_WALLS);
+	const __m128i neighbours = _mm_set1_epi16(c_NEIGHBOURS);
+	const __m128i leftWall = _mm_set1_epi16(c_LEFT_WALL);
+	const __m128i rightWall = _mm_set1_epi16(c_RIGHT_WALL);
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		const __m128i walled = _mm_or_si128(_mm_slli_epi16(rows[i], 1), walls);
+		rowChanges[i] = _mm_and_si128(_mm_xor_si128(walled, _mm_srli_epi16(walled, 1)), neighbours);
+		columnChanges[i] = _mm_xor_si128(rows[i], upper[i]);
+
+		// Open cells with a block or wall on both sides.
+		const __m128i left = _mm_or_si128(_mm_slli_epi16(rows[i], 1), leftWall);
+		const __m128i right = _mm_or_si128(_mm_srli_epi16(rows[i], 1), rightWall);
+		wells[i] = _mm_andnot_si128(_mm_or_si128(rows[i], covered[i]), _mm_and_si128(_mm_and_si128(left, right), full));
+	}
+
+	features.holes = CountCells(holes);
+	features.coveredCells = CountCells(overHoles);
+	features.rowTransitions = CountCells(rowChanges);
+	features.columnTransitions = CountCells(columnChanges);
+
+	// A well cell n deep is still left after n - 1 rounds of keeping only the
+	// cells with a well cell above, so it's counted n times.
+	features.wells = 0;
+	for (unsigned int count = CountCells(wells); count != 0; count = CountCells(wells))
+	{
+		features.wells += count;
+
+		RowBlock wellsAbove;
+		ShiftDown(wells, wellsAbove);
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			wells[i] = _mm_and_si128(wells[i], wellsAbove[i]);
+		}
+	}
+}
+
+static void ComputeHeightFeatures(const uint8_t* paddedHeights, BoardFeatures& features)
+{
+	const __m128i heights = _mm_load_si128(reinterpret_cast<const __m128i*>(paddedHeights));
+	const __m128i zero = _mm_setzero_si128();
+
+	const __m128i sum = _mm_sad_epu8(heights, zero);
+	features.aggregateHeight = static_cast<unsigned int>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+
+	// Against the heights one column along, the last column is compared with the padding.
+	const __m128i differences = _mm_sad_epu8(heights, _mm_srli_si128(heights, 1));
+	features.bumpiness = static_cast<unsigned int>(_mm_cvtsi128_si32(differences) + _mm_cvtsi128_si32(_mm_srli_si128(differences, 8)) - paddedHeights[c_COLS - 1]);
+
+	__m128i highest = _mm_max_epu8(heights, _mm_srli_si128(heights, 8));
+	highest = _mm_max_epu8(highest, _mm_srli_si128(highest, 4));
+	highest = _mm_max_epu8(highest, _mm_srli_si128(highest, 2));
+	highest = _mm_max_epu8(highest, _mm_srli_si128(highest, 1));
+	features.maxHeight = static_cast<unsigned int>(_mm_cvtsi128_si32(highest) & 0xFF);
+}
+#else
+static void ComputeCellFeatures(const uint16_t* paddedRows, BoardFeatures& features)
+{
+	uint16_t covered[c_PADDED_ROWS];
+	uint16_t holes[c_PADDED_ROWS];
+	uint16_t wells[c_PADDED_ROWS];
+
+	features.holes = 0;
+	features.rowTransitions = 0;
+	features.columnTransitions = 0;
+
+	uint16_t above = 0;
+	uint16_t upper = 0;
+	for (unsigned int row = 0; row < c_PADDED_ROWS; row++)
+	{
+		const uint16_t cells = paddedRows[row];
+		covered[row] = above;
+		holes[row] = above & ~cells;
+		above |= cells;
+
+		const uint16_t walled = (cells << 1) | c_WALLS;
+		const uint16_t left = (cells << 1) | c_LEFT_WALL;
+		const uint16_t right = (cells >> 1) | c_RIGHT_WALL;
+		wells[row] = left & right & c_FULL & ~(cells | covered[row]);
+
+		features.holes += PopCount(holes[row]);
+		features.rowTransitions += PopCount((walled ^ (walled >> 1)) & c_NEIGHBOURS);
+		features.columnTransitions += PopCount(cells ^ upper);
+		upper = cells;
+	}
+
+	features.coveredCells = 0;
+	uint16_t below = 0;
+	for (unsigned int row = c_PADDED_ROWS; row-- > 0;)
+	{
+		below |= holes[row];
+		features.coveredCells += PopCount(paddedRows[row] & below);
+	}
+
+	// A well cell n deep is counted once for each well cell above it and itself.
+	features.wells = 0;
+	for (bool any = true; any;)
+	{
+		any = false;
+		for (unsigned int row = c_PADDED_ROWS; row-- > 0;)
+		{
+			features.wells += PopCount(wells[row]);
+			any |= wells[row] != 0;
+			wells[row] &= row > 0 ? wells[row - 1] : 0;
+		}
+	}
+}
+
+static void ComputeHeightFeatures(const uint8_t* paddedHeights, BoardFeatures& features)
+{
+	features.aggregateHeight = 0;
+	features.maxHeight = 0;
+	features.bumpiness = 0;
+
+	for (unsigned int col = 0; col < c_COLS; col++)
+	{
+		features.aggregateHeight += paddedHeights[col];
+		if (paddedHeights[col] > features.maxHeight)
+			features.maxHeight = paddedHeights[col];
+
+		if (col > 0)
+			features.bumpiness += paddedHeights[col] > paddedHeights[col - 1] ? paddedHeights[col] - paddedHeights[col - 1] : paddedHeights[col - 1] - paddedHeights[col];
+	}
+}
+#endif
+
+BoardFeatures ComputeFeatures(const Playfield& field)
+{
+	BoardFeatures features;
+
+	alignas(16) uint16_t paddedRows[c_PADDED_ROWS];
+	const Playfield::RowArray& rows = field.GetRows();
+	for (unsigned int row = 0; row < c_PADDED_ROWS; row++)
+	{
+		paddedRows[row] = row < c_ROWS ? rows[row] : c_FULL;
+	}
+
+	alignas(16) uint8_t paddedHeights[16] = {};
+	for (unsigned int col = 0; col < c_COLS; col++)
+	{
+		paddedHeights[col] = static_cast<uint8_t>(field.GetHeight(col));
+		features.heights[col] = paddedHeights[col];
+	}
+
+	ComputeCellFeatures(paddedRows, features);
+	ComputeHeightFeatures(paddedHeights, features);
+	return features;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include "playfield.h"
+
+/*
+	The usual features bots weigh up to judge a board, e.g. after each candidate
+	placement. Holes are empty cells with a block somewhere above them in the same
+	column, the walls count as filled for transitions and wells, and the floor
+	counts as filled for column transitions.
+*/
+struct BoardFeatures
+{
+	uint8_t heights[Playfield::c_NUM_COLS];
+	unsigned int aggregateHeight; // Sum of the column heights
+	unsigned int maxHeight;
+	unsigned int bumpiness;         // Sum of the height differences between neighbouring columns
+	unsigned int holes;
+	unsigned int coveredCells;      // Blocks with a hole somewhere below them
+	unsigned int rowTransitions;    // Filled cells next to empty ones along each row
+	unsigned int columnTransitions; // Filled cells above or below empty ones in each column
+	unsigned int wells;             // Empty cells open to the sky between two filled ones, each counted as deep as it is in its well
+};
+
+/*
+	Works out every feature at once from the row masks. With SSE2, on every
+	x86-64 compiler, the rows are processed eight at a time in 16 bit lanes,
+	column prefixes are spread down the board with byte shifts and the cells are
+	counted in the registers, so there are no loops over cells or columns. Other
+	targets run the same mask operations one row at a time.
+*/
+BoardFeatures ComputeFeatures(const Playfield& field);
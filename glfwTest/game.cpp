@@ -0,0 +1,591 @@
+#include "game.h"
+#include "zobrist.h"
+
+Game::Game()
+{
+	m_observer = nullptr;
+	m_randomizer = &c_DEFAULT_RANDOMIZER;
+	m_pieces = &c_STANDARD_PIECES;
+	m_spinRule = SpinRule::T_SPIN;
+	m_cascade = false;
+	m_startLevel = 1;
+	m_randomizer->Seed(m_state.random, 0);
+	m_state.queue.depth = PieceQueue::c_DEFAULT_DEPTH;
+	Reset();
+}
+
+void Game::Reset()
+{
+	m_state.field.Clear();
+	m_state.piece = PieceState();
+	m_state.activePiece = false;
+	m_state.gameOver = false;
+	m_state.tick = 0;
+	m_state.gravityRows = 0;
+	m_state.lines = 0;
+	m_state.level = m_startLevel;
+	m_state.lockTimer = 0;
+	m_state.lockResets = 0;
+	m_state.lowestRow = 0;
+	m_state.lastKick = c_NO_KICK;
+	m_state.lastClear = ClearResult();
+	m_state.score = 0;
+	m_state.combo = 0;
+	m_state.backToBack = false;
+	m_state.garbage.Clear();
+	m_state.hold = PieceType();
+	m_state.hasHold = false;
+	m_state.holdUsed = false;
+
+	m_state.queue.Clear();
+	FillQueue();
+}
+
+void Game::SetObserver(GameObserver* observer)
+{
+	m_observer = observer;
+}
+
+void Game::SetRandomizer(const Randomizer* randomizer)
+{
+	m_randomizer = randomizer ? randomizer : &c_DEFAULT_RANDOMIZER;
+}
+
+void Game::SetQueueDepth(unsigned int depth)
+{
+	if (depth < PieceQueue::c_MIN_DEPTH)
+		depth = PieceQueue::c_MIN_DEPTH;
+	else if (depth > PieceQueue::c_MAX_DEPTH)
+		depth = PieceQueue::c_MAX_DEPTH;
+
+	m_state.queue.depth = static_cast<uint8_t>(depth);
+
+	// A shorter queue keeps the pieces already dealt past its end so the order does not change, a longer one is dealt straight away.
+	FillQueue();
+}
+
+void Game::FillQueue()
+{
+	while (m_state.queue.count < m_state.queue.depth)
+	{
+		m_state.queue.Push(m_randomizer->Next(m_state.random, m_pieces->numTypes));
+	}
+}
+
+void Game::Seed(uint64_t seed)
+{
+	m_randomizer->Seed(m_state.random, seed);
+
+	// Deal the queue again from the new seed.
+	m_state.queue.Clear();
+	FillQueue();
+}
+
+void Game::SetPieceSet(const PieceSet* pieces)
+{
+	m_pieces = pieces ? pieces : &c_STANDARD_PIECES;
+	Reset();
+}
+
+const PieceSet& Game::GetPieceSet() const
+{
+	return *m_pieces;
+}
+
+void Game::SetSpinRule(SpinRule rule)
+{
+	m_spinRule = rule;
+}
+
+SpinRule Game::GetSpinRule() const
+{
+	return m_spinRule;
+}
+
+void Game::SetCascadeGravity(bool enabled)
+{
+	m_cascade = enabled;
+}
+
+void Game::SaveState(GameState& state) const
+{
+	state = m_state;
+}
+
+void Game::RestoreState(const GameState& state)
+{
+	m_state = state;
+}
+
+void Game::Tick()
+{
+	m_state.tick++;
+
+	if (m_state.gameOver)
+		return;
+
+	m_state.garbage.Tick();
+
+	if (!m_state.activePiece)
+	{
+		SpawnPiece();
+		return;
+	}
+
+	// Gravity builds up in fractions of a row, the whole rows are dropped in one go
+	// since DropDistance finds the landing row straight from the column heights.
+	m_state.gravityRows += c_GRAVITY_TABLE[m_state.level - 1];
+	if (m_state.gravityRows >= c_GRAVITY_ONE_ROW)
+	{
+		DropPiece(static_cast<int>(m_state.gravityRows >> 16));
+		m_state.gravityRows &= c_GRAVITY_ONE_ROW - 1;
+	}
+
+	// Lock the piece once it has been resting on the stack for the lock delay.
+	if (m_state.field.DropDistance(m_state.piece, *m_pieces) == 0)
+	{
+		if (++m_state.lockTimer >= c_LOCK_DELAY_TICKS)
+			LockPiece();
+	}
+}
+
+void Game::Tick(unsigned int ticks)
+{
+	while (ticks > 0)
+	{
+		// Run the ticks in which nothing happens in one go, then the one that does something.
+		unsigned int idle = GetTicksUntilUpdate() - 1;
+		if (idle > ticks)
+			idle = ticks;
+
+		SkipIdleTicks(idle);
+		ticks -= idle;
+
+		if (ticks > 0)
+		{
+			Tick();
+			ticks--;
+		}
+	}
+}
+
+uint64_t Game::GetTick() const
+{
+	return m_state.tick;
+}
+
+unsigned int Game::GetTicksUntilUpdate() const
+{
+	if (m_state.gameOver)
+		return c_NO_DEADLINE;
+
+	if (!m_state.activePiece)
+		return 1;
+
+	// A piece resting on the stack waits out its lock delay, gravity can not move it.
+	if (m_state.field.DropDistance(m_state.piece, *m_pieces) == 0)
+		return m_state.lockTimer < c_LOCK_DELAY_TICKS ? c_LOCK_DELAY_TICKS - m_state.lockTimer : 1;
+
+	// Otherwise it falls once gravity builds up to a whole row.
+	const uint32_t gravity = c_GRAVITY_TABLE[m_state.level - 1];
+	return (c_GRAVITY_ONE_ROW - m_state.gravityRows + gravity - 1) / gravity;
+}
+
+/*
+	Does what ticks calls to Tick would do when GetTicksUntilUpdate says none of
+	them spawn, drop or lock anything, in constant time.
+*/
+void Game::SkipIdleTicks(unsigned int ticks)
+{
+	if (ticks == 0)
+		return;
+
+	m_state.tick += ticks;
+
+	if (m_state.gameOver)
+		return;
+
+	m_state.garbage.Tick(ticks);
+
+	// Gravity keeps building up under a resting piece, dropping nothing whenever it reaches a row.
+	const uint64_t gravityRows = m_state.gravityRows + static_cast<uint64_t>(c_GRAVITY_TABLE[m_state.level - 1]) * ticks;
+	m_state.gravityRows = static_cast<uint32_t>(gravityRows & (c_GRAVITY_ONE_ROW - 1));
+
+	if (m_state.field.DropDistance(m_state.piece, *m_pieces) == 0)
+		m_state.lockTimer = static_cast<uint8_t>(m_state.lockTimer + ticks);
+}
+
+void Game::SetStartLevel(unsigned int level)
+{
+	if (level < 1)
+		level = 1;
+	else if (level > c_MAX_LEVEL)
+		level = c_MAX_LEVEL;
+
+	m_startLevel = static_cast<uint8_t>(level);
+	Reset();
+}
+
+unsigned int Game::GetLevel() const
+{
+	return m_state.level;
+}
+
+double Game::GetGravity() const
+{
+	return static_cast<double>(c_GRAVITY_TABLE[m_state.level - 1]) / c_GRAVITY_ONE_ROW;
+}
+
+void Game::ApplyInstantGravity()
+{
+	// At 20G the piece is always resting on the stack, even straight after spawning or moving.
+	if (c_GRAVITY_TABLE[m_state.level - 1] < c_GRAVITY_20G)
+		return;
+
+	int rows = m_state.field.DropDistance(m_state.piece, *m_pieces);
+	if (rows > 0)
+	{
+		// Unlike a drop this keeps the last kick, a rotation that lands the piece can still be a spin.
+		m_state.piece.y += rows;
+		OnPieceFell();
+	}
+}
+
+bool Game::SpawnPiece()
+{
+	PieceType type = m_state.queue.Pop();
+	FillQueue();
+
+	return SpawnPiece(type);
+}
+
+bool Game::SpawnPiece(PieceType type)
+{
+	m_state.piece = SpawnState(type, Playfield::c_NUM_COLS, *m_pieces);
+
+	// The stack has reached the top of the board.
+	if (m_state.field.Collides(m_state.piece, *m_pieces))
+	{
+		m_state.activePiece = false;
+		m_state.gameOver = true;
+		return false;
+	}
+
+	m_state.activePiece = true;
+	m_state.gravityRows = 0;
+	m_state.lockTimer = 0;
+	m_state.lockResets = 0;
+	m_state.lowestRow = m_state.piece.y;
+	m_state.lastKick = c_NO_KICK;
+	ApplyInstantGravity();
+	return true;
+}
+
+bool Game::HoldPiece()
+{
+	if (!m_state.activePiece || m_state.holdUsed)
+		return false;
+
+	PieceType held = m_state.hold;
+	bool hadHold = m_state.hasHold;
+
+	m_state.hold = m_state.piece.type;
+	m_state.hasHold = true;
+
+	if (hadHold)
+		SpawnPiece(held);
+	else
+		SpawnPiece();
+
+	m_state.holdUsed = true;
+	return true;
+}
+
+bool Game::MovePiece(int x, int y)
+{
+	if (!m_state.activePiece)
+		return false;
+
+	PieceState moved = m_state.piece;
+	moved.x += x;
+	moved.y += y;
+
+	if (m_state.field.Collides(moved, *m_pieces))
+		return false;
+
+	m_state.piece = moved;
+	m_state.lastKick = c_NO_KICK;
+	ResetLockDelay();
+	ApplyInstantGravity();
+	return true;
+}
+
+bool Game::RotatePiece(int direction)
+{
+	if (!m_state.activePiece)
+		return false;
+
+	const Kick* kicks = m_pieces->GetKicks(m_state.piece.type, m_state.piece.rotation, direction);
+
+	PieceState rotated = m_state.piece;
+	rotated.rotation = (m_state.piece.rotation + direction) & 3;
+
+	// Use the first of the SRS kicks that fits.
+	for (unsigned int i = 0; i < c_NUM_KICKS; i++)
+	{
+		rotated.x = m_state.piece.x + kicks[i].x;
+		rotated.y = m_state.piece.y - kicks[i].y; // Kicks count rows upwards, the board counts them downwards.
+
+		if (!m_state.field.Collides(rotated, *m_pieces))
+		{
+			m_state.piece = rotated;
+			m_state.lastKick = static_cast<uint8_t>(i);
+			ResetLockDelay();
+			ApplyInstantGravity();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int Game::DropPiece(int rows)
+{
+	if (!m_state.activePiece || rows <= 0)
+		return 0;
+
+	int moved = m_state.field.DropDistance(m_state.piece, *m_pieces);
+	if (moved > rows)
+		moved = rows;
+
+	m_state.piece.y += moved;
+
+	if (moved > 0)
+	{
+		OnPieceFell();
+		m_state.lastKick = c_NO_KICK;
+	}
+
+	return moved;
+}
+
+void Game::HardDrop()
+{
+	if (!m_state.activePiece)
+		return;
+
+	// Dropping a row forgets the last rotation, as a soft drop does, so it can't score a spin.
+	const int rows = m_state.field.DropDistance(m_state.piece, *m_pieces);
+	if (rows > 0)
+	{
+		m_state.piece.y += rows;
+		m_state.lastKick = c_NO_KICK;
+	}
+
+	LockPiece();
+}
+
+PieceState Game::GetLandingPiece() const
+{
+	PieceState landed = m_state.piece;
+	if (m_state.activePiece)
+		landed.y += m_state.field.DropDistance(m_state.piece, *m_pieces);
+
+	return landed;
+}
+
+void Game::ResetLockDelay()
+{
+	if (m_state.lockResets < c_MAX_LOCK_RESETS)
+	{
+		m_state.lockTimer = 0;
+		m_state.lockResets++;
+	}
+}
+
+void Game::OnPieceFell()
+{
+	// Only a row the piece hasn't been down to before gives a fresh lock delay and its resets back, falling back
+	// after a kick up carries on with the lock delay where it was.
+	if (m_state.piece.y > m_state.lowestRow)
+	{
+		m_state.lowestRow = m_state.piece.y;
+		m_state.lockTimer = 0;
+		m_state.lockResets = 0;
+	}
+}
+
+void Game::LockPiece()
+{
+	if (!m_state.activePiece)
+		return;
+
+	// Spins are judged against the stack before the piece joins it.
+	ClearResult result;
+	result.spin = DetectSpin(m_state.field, m_state.piece, m_state.lastKick, *m_pieces, m_spinRule);
+
+	m_state.field.Place(m_state.piece, *m_pieces);
+	m_state.activePiece = false;
+	m_state.holdUsed = false;
+
+	if (m_observer)
+		m_observer->OnPieceLocked(m_state.piece);
+
+	result.lines = static_cast<uint8_t>(ClearRows(m_state.piece));
+	result.combo = 0;
+	result.backToBack = false;
+	result.attack = 0;
+	result.sent = 0;
+
+	if (result.lines > 0)
+	{
+		result.combo = m_state.combo;
+		if (m_state.combo < 0xFF)
+			m_state.combo++;
+
+		const bool difficult = IsDifficultClear(result);
+		result.backToBack = difficult && m_state.backToBack;
+		m_state.backToBack = difficult;
+
+		// The attack cancels incoming garbage before any of it is sent on.
+		result.attack = static_cast<uint8_t>(GetClearAttack(result));
+		result.sent = static_cast<uint8_t>(m_state.garbage.Cancel(result.attack));
+	}
+	else
+	{
+		m_state.combo = 0;
+		InsertGarbage();
+	}
+
+	m_state.lastClear = result;
+	m_state.score += GetClearScore(result) * m_state.level;
+
+	// Every c_LINES_PER_LEVEL lines go up a level, and gravity with it.
+	m_state.lines = static_cast<uint16_t>(m_state.lines + result.lines);
+	unsigned int level = m_startLevel + m_state.lines / c_LINES_PER_LEVEL;
+	m_state.level = static_cast<uint8_t>(level < c_MAX_LEVEL ? level : c_MAX_LEVEL);
+
+	if (m_observer)
+		m_observer->OnClearResult(result);
+}
+
+void Game::InsertGarbage()
+{
+	unsigned int inserted = 0;
+	while (!m_state.garbage.IsEmpty() && m_state.garbage.Front().timer == 0 && inserted < c_GARBAGE_CAP)
+	{
+		GarbageQueue::Entry& entry = m_state.garbage.Front();
+		unsigned int lines = entry.lines < c_GARBAGE_CAP - inserted ? entry.lines : c_GARBAGE_CAP - inserted;
+
+		// Pushing the stack off the top of the board ends the game.
+		if (!m_state.field.InsertGarbage(lines, entry.holeCol))
+			m_state.gameOver = true;
+
+		if (m_observer)
+			m_observer->OnGarbageInserted(lines, entry.holeCol);
+
+		inserted += lines;
+		entry.lines = static_cast<uint8_t>(entry.lines - lines);
+		if (entry.lines == 0)
+			m_state.garbage.Pop();
+	}
+}
+
+unsigned int Game::ClearRows(const PieceState& piece)
+{
+	// Only the rows the piece was placed on can have been filled.
+	const PieceRotation& rotation = m_pieces->GetRotation(piece.type, piece.rotation);
+	uint64_t cleared = m_state.field.ClearFullRows(piece.y + rotation.minRow, piece.y + rotation.maxRow);
+
+	if (!cleared)
+		return 0;
+
+	if (m_observer)
+		m_observer->OnRowsCleared(cleared);
+
+	unsigned int lines = PopCount64(cleared);
+
+	// Rows cleared by the chain reaction count towards the same clear.
+	if (m_cascade)
+	{
+		GameObserver* observer = m_observer;
+		lines += m_state.field.Cascade(
+			[observer](const Playfield::RowArray& cluster, unsigned int distance)
+			{
+				if (observer)
+					observer->OnClusterDropped(cluster, distance);
+			},
+			[observer](uint64_t rows)
+			{
+				if (observer)
+					observer->OnRowsCleared(rows);
+			});
+	}
+
+	return lines;
+}
+
+bool Game::HasActivePiece() const
+{
+	return m_state.activePiece;
+}
+
+bool Game::IsGameOver() const
+{
+	return m_state.gameOver;
+}
+
+const Playfield& Game::GetPlayfield() const
+{
+	return m_state.field;
+}
+
+const PieceState& Game::GetPiece() const
+{
+	return m_state.piece;
+}
+
+const PieceQueue& Game::GetQueue() const
+{
+	return m_state.queue;
+}
+
+bool Game::HasHeldPiece() const
+{
+	return m_state.hasHold;
+}
+
+PieceType Game::GetHeldPiece() const
+{
+	return m_state.hold;
+}
+
+void Game::ReceiveGarbage(unsigned int lines, unsigned int holeCol)
+{
+	if (lines > 0 && holeCol < Playfield::c_NUM_COLS)
+		m_state.garbage.Push(lines, holeCol, c_GARBAGE_DELAY_TICKS);
+}
+
+const GarbageQueue& Game::GetGarbage() const
+{
+	return m_state.garbage;
+}
+
+uint32_t Game::GetScore() const
+{
+	return m_state.score;
+}
+
+const ClearResult& Game::GetLastClear() const
+{
+	return m_state.lastClear;
+}
+
+uint64_t Game::GetHash() const
+{
+	uint64_t hash = m_state.field.GetHash();
+	if (m_state.activePiece)
+		hash ^= c_ZOBRIST_PIECE_KEYS[static_cast<unsigned int>(m_state.piece.type)];
+
+	return hash;
+}
@@ -0,0 +1,230 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include "playfield.h"
+#include "piece.h"
+#include "randomizer.h"
+#include "piecequeue.h"
+#include "scoring.h"
+#include "garbage.h"
+
+/*
+	Gets told about changes to the board that are not visible from the playfield
+	bits alone, e.g. so a renderer can keep track of the colour of each block.
+*/
+class GameObserver
+{
+public:
+	virtual ~GameObserver() = default;
+
+	virtual void OnPieceLocked(const PieceState& /*piece*/) {}
+
+	// Bit n of rows is set if row n was full, rows are numbered from before the clear.
+	virtual void OnRowsCleared(uint64_t /*rows*/) {}
+
+	// After every lock, lines being 0 if nothing was cleared. result.sent is the garbage to pass to the opponent.
+	virtual void OnClearResult(const ClearResult& /*result*/) {}
+
+	// A cluster of blocks fell distance rows under cascade gravity, cluster being where it was before.
+	virtual void OnClusterDropped(const Playfield::RowArray& /*cluster*/, unsigned int /*distance*/) {}
+
+	// Garbage rows were pushed in under the stack, every row moving up by lines.
+	virtual void OnGarbageInserted(unsigned int /*lines*/, unsigned int /*holeCol*/) {}
+};
+
+/*
+	Everything that changes while a game is played. Fixed size and trivially
+	copyable so saving or restoring a game, e.g. for search or rollback, is a
+	single memcpy with no allocation. Kept within three cache lines.
+*/
+struct GameState
+{
+	Playfield field;
+	PieceState piece;
+	bool activePiece;
+	bool gameOver;
+	uint16_t lines;        // Lines cleared this game, every 10 go up a level
+	uint8_t level;
+	RandomizerState random;
+	PieceQueue queue;
+	PieceType hold;
+	bool hasHold;
+	bool holdUsed; // The falling piece came out of hold, it can't go back until it locks
+	uint32_t gravityRows; // Part of a row of gravity built up, 16.16 fixed point
+	uint8_t lockTimer;  // Ticks the piece has been resting on the stack
+	uint8_t lockResets; // Moves that have restarted the lock delay since the piece reached lowestRow
+	int8_t lowestRow;   // Lowest row the piece has fallen to, only falling below it gives back the lock resets
+	uint8_t lastKick;   // Kick used by the piece's last move if it was a rotation, c_NO_KICK otherwise
+	ClearResult lastClear;
+	uint32_t score;
+	uint8_t combo;   // Clears in a row so far
+	bool backToBack; // The last clear was a difficult one
+	GarbageQueue garbage;
+	uint64_t tick;
+};
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must be copyable with memcpy");
+static_assert(sizeof(GameState) <= 192, "GameState should fit in three cache lines");
+
+/*
+	The rules of the game: spawning, moving, rotating, locking pieces and clearing
+	rows. Has no dependency on OpenGL or GLFW so it can be run headless.
+*/
+class Game
+{
+public:
+	// The simulation always advances in steps of 1 / c_TICKS_PER_SECOND seconds.
+	static constexpr unsigned int c_TICKS_PER_SECOND = 60;
+
+	/*
+		Gravity in rows per tick, 16.16 fixed point, for each level. Levels 1 - 15
+		follow the guideline curve of (0.8 - (level - 1) * 0.007) ^ (level - 1)
+		seconds per row, rounded up, the last five climb to 20G where pieces land
+		the moment they appear.
+	*/
+	static constexpr unsigned int c_MAX_LEVEL = 20;
+	static constexpr unsigned int c_LINES_PER_LEVEL = 10;
+	static constexpr uint32_t c_GRAVITY_ONE_ROW = 1u << 16;
+	static constexpr uint32_t c_GRAVITY_20G = 20 * c_GRAVITY_ONE_ROW;
+	static constexpr uint32_t c_GRAVITY_TABLE[c_MAX_LEVEL] =
+	{
+		1093, 1378, 1769, 2311, 3076, 4169, 5759, 8107, 11635, 17027,
+		25416, 38709, 60169, 95484, 154743,
+		3 * c_GRAVITY_ONE_ROW, 5 * c_GRAVITY_ONE_ROW, 10 * c_GRAVITY_ONE_ROW, 15 * c_GRAVITY_ONE_ROW, c_GRAVITY_20G,
+	};
+
+	/*
+		A piece locks after resting on the stack this long. Moving or rotating
+		restarts the wait, at most c_MAX_LOCK_RESETS times until the piece falls
+		lower than it has been before, so kicking up and falling back can't stall.
+	*/
+	static constexpr unsigned int c_LOCK_DELAY_TICKS = c_TICKS_PER_SECOND / 2;
+	static constexpr unsigned int c_MAX_LOCK_RESETS = 15;
+
+	// Incoming garbage waits this long before it can be inserted, and at most c_GARBAGE_CAP rows go in per piece.
+	static constexpr unsigned int c_GARBAGE_DELAY_TICKS = c_TICKS_PER_SECOND / 3;
+	static constexpr unsigned int c_GARBAGE_CAP = 8;
+
+	Game();
+	void Reset();
+	void SetObserver(GameObserver* observer);
+
+	// The game uses the 7-bag randomizer unless another one is given, nullptr restores it.
+	void SetRandomizer(const Randomizer* randomizer);
+	void Seed(uint64_t seed);
+
+	// The game plays with the standard tetrominoes unless another set is given, nullptr restores them.
+	// The set must outlive the game. Changing the set starts a new game.
+	void SetPieceSet(const PieceSet* pieces);
+	const PieceSet& GetPieceSet() const;
+
+	// Only T-spins score by default, ALL_SPIN also rewards other pieces locked in place by a rotation.
+	void SetSpinRule(SpinRule rule);
+	SpinRule GetSpinRule() const;
+
+	// With cascade gravity the stack falls apart into clusters after a clear and each one drops on its own, which can chain more clears.
+	void SetCascadeGravity(bool enabled);
+
+	// Copies the whole state of the game, including the randomizer, out and back in.
+	void SaveState(GameState& state) const;
+	void RestoreState(const GameState& state);
+
+	/*
+		Advances the game by one fixed time step: spawns a piece if there is none,
+		applies gravity and locks the piece once its lock delay runs out. The game only depends on the number of ticks, never on the
+		wall clock, so it plays out the same however fast the ticks are run.
+	*/
+	void Tick();
+	void Tick(unsigned int ticks);
+	uint64_t GetTick() const;
+
+	// Returned by GetTicksUntilUpdate when nothing will happen without input, e.g. once the game is over.
+	static constexpr unsigned int c_NO_DEADLINE = ~0u;
+
+	/*
+		Number of ticks until the first one that spawns, drops or locks a piece.
+		The ticks before it only move counters along, so a host can sleep until
+		then and catch up with Tick(ticks), which skips them in one step.
+	*/
+	unsigned int GetTicksUntilUpdate() const;
+
+	// Level the next game starts at, 1 - c_MAX_LEVEL. Starts a new game.
+	void SetStartLevel(unsigned int level);
+	unsigned int GetLevel() const;
+
+	// Rows the falling piece drops per tick at the current level.
+	double GetGravity() const;
+
+	// Number of pieces dealt ahead, clamped to PieceQueue::c_MIN_DEPTH - c_MAX_DEPTH.
+	void SetQueueDepth(unsigned int depth);
+
+	/*
+		Swaps the falling piece with the held one, or with the next piece if nothing
+		is held yet. Allowed once per piece, returns false if the swap was refused.
+	*/
+	bool HoldPiece();
+
+	// Spawns a new falling piece, the type comes from the front of the queue when not given. Returns false and ends the game if there is no room for it.
+	bool SpawnPiece();
+	bool SpawnPiece(PieceType type);
+
+	// Moves the falling piece x columns right and y rows down, returns false if the move is illegal.
+	bool MovePiece(int x, int y);
+
+	// Quarter turn of the falling piece with SRS kicks, 1 for clockwise and -1 for counter-clockwise.
+	bool RotatePiece(int direction);
+
+	// Moves the falling piece down at most rows rows, stopping on the stack. Returns the rows moved.
+	int DropPiece(int rows);
+
+	// Drops the falling piece onto the stack and locks it straight away.
+	void HardDrop();
+
+	// Where the falling piece would land if dropped, e.g. for drawing a ghost piece.
+	PieceState GetLandingPiece() const;
+
+	// Adds the falling piece to the playfield and clears any full rows.
+	void LockPiece();
+
+	bool HasActivePiece() const;
+	bool IsGameOver() const;
+	const Playfield& GetPlayfield() const;
+	const PieceState& GetPiece() const;
+
+	// The upcoming pieces and the held piece, read in place from the game state.
+	const PieceQueue& GetQueue() const;
+	bool HasHeldPiece() const;
+	PieceType GetHeldPiece() const;
+
+	/*
+		Queues garbage sent by an opponent. It is canceled by the attacks this game
+		makes in the meantime, and whatever is left goes in under the stack when a
+		piece locks without clearing a line after the delay has run out.
+	*/
+	void ReceiveGarbage(unsigned int lines, unsigned int holeCol);
+	const GarbageQueue& GetGarbage() const;
+
+	// Points scored so far, and what the last piece to lock achieved.
+	uint32_t GetScore() const;
+	const ClearResult& GetLastClear() const;
+
+	// Zobrist hash of the position: the locked blocks and the type of the falling piece.
+	uint64_t GetHash() const;
+
+private:
+	void FillQueue();
+	void ResetLockDelay();
+	void OnPieceFell();
+	void ApplyInstantGravity();
+	void SkipIdleTicks(unsigned int ticks);
+	void InsertGarbage();
+	unsigned int ClearRows(const PieceState& piece);
+
+	GameState m_state;
+	GameObserver* m_observer;
+	const Randomizer* m_randomizer;
+	const PieceSet* m_pieces;
+	SpinRule m_spinRule;
+	bool m_cascade;
+	uint8_t m_startLevel;
+};
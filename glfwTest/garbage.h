@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+
+/*
+	Garbage sent by opponents that has not reached the board yet. Each attack
+	waits out a delay before it can be inserted, and attacks sent back in the
+	meantime cancel it, oldest first. A fixed ring buffer inside the game state
+	so versus games can still be saved with a memcpy.
+*/
+struct GarbageQueue
+{
+	struct Entry
+	{
+		uint8_t lines;
+		uint8_t holeCol;
+		uint16_t timer; // Ticks left before it can be inserted
+	};
+
+	static constexpr unsigned int c_CAPACITY = 8;
+
+	Entry entries[c_CAPACITY];
+	uint8_t head;
+	uint8_t count;
+
+	void Clear()
+	{
+		head = 0;
+		count = 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return count == 0;
+	}
+
+	Entry& Front()
+	{
+		return entries[head];
+	}
+
+	// Total rows waiting, ready or not.
+	unsigned int GetPendingLines() const
+	{
+		unsigned int lines = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			lines += entries[(head + i) % c_CAPACITY].lines;
+		}
+
+		return lines;
+	}
+
+	// Queues an attack, merging it into the newest one if the queue is full.
+	void Push(unsigned int lines, unsigned int holeCol, unsigned int delay)
+	{
+		if (count == c_CAPACITY)
+		{
+			Entry& last = entries[(head + count - 1) % c_CAPACITY];
+			unsigned int merged = last.lines + lines;
+			last.lines = static_cast<uint8_t>(merged < 0xFF ? merged : 0xFF);
+			return;
+		}
+
+		Entry& entry = entries[(head + count) % c_CAPACITY];
+		entry.lines = static_cast<uint8_t>(lines < 0xFF ? lines : 0xFF);
+		entry.holeCol = static_cast<uint8_t>(holeCol);
+		entry.timer = static_cast<uint16_t>(delay);
+		count++;
+	}
+
+	void Pop()
+	{
+		head = (head + 1) % c_CAPACITY;
+		count--;
+	}
+
+	// Cancels pending garbage against an attack, returns what is left of the attack to send on.
+	unsigned int Cancel(unsigned int attack)
+	{
+		while (attack > 0 && count > 0)
+		{
+			Entry& entry = Front();
+			if (entry.lines > attack)
+			{
+				entry.lines = static_cast<uint8_t>(entry.lines - attack);
+				return 0;
+			}
+
+			attack -= entry.lines;
+			Pop();
+		}
+
+		return attack;
+	}
+
+	// Counts every delay down by the given number of ticks.
+	void Tick(unsigned int ticks = 1)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Entry& entry = entries[(head + i) % c_CAPACITY];
+			entry.timer = static_cast<uint16_t>(entry.timer > ticks ? entry.timer - ticks : 0);
+		}
+	}
+};
@@ -2,6 +2,7 @@
 //
 
 #include <iostream>
+#include <stdexcept>
 
 // OpenGL libraries and extensitons.
 #include "glfwTest.h"
@@ -10,76 +11,74 @@
 #include <glfw3.h>
 
 #include "board.h"
+#include "clock.h"
 
 void error_callback(int error, const char* description)
 {
 	std::cerr << "Error: " << description << std::endl;
 }
 
+/*
+	Draws the board and shows it. Frames are only drawn when the game changes or
+	the window asks for it, not continuously.
+*/
+void renderFrame(GLFWwindow* window)
+{
+	Board* board = static_cast<Board*>(glfwGetWindowUserPointer(window));
+	if (!board)
+		return;
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	board->Render();
+	glfwSwapBuffers(window);
+}
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	Board* board = static_cast<Board*>(glfwGetWindowUserPointer(window));
 
-	if (action == GLFW_PRESS)
+	// GLFW does not timestamp events, so take the time as close to the callback as we can.
+	// Held keys are repeated by the input handler, the OS key repeat is ignored.
+	double time = glfwGetTime();
+
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 	{
-		if (key == GLFW_KEY_ESCAPE)
-			glfwSetWindowShouldClose(window, true);
-		else if (key == GLFW_KEY_W)
-		{
-			board->Flip();
-		}
-		else if (key == GLFW_KEY_A)
-		{
-			board->SetMoveDirection(-1, 0);
-		}
-		else if (key == GLFW_KEY_S)
-		{
-			board->SetMoveDirection(0, -1);
-		}
-		else if (key == GLFW_KEY_D)
-		{
-			board->SetMoveDirection(1, 0);
-		}
-		// Drop the piece
-		else if (key == GLFW_KEY_SPACE)
-		{
-			board->Drop();
-		}
+		glfwSetWindowShouldClose(window, true);
+		return;
 	}
-	else if (action == GLFW_RELEASE)
+
+	// Undo and redo step through the pieces placed this game, drawn straight away as no tick may be due.
+	if (action == GLFW_PRESS && (key == GLFW_KEY_Z || key == GLFW_KEY_Y))
 	{
-		if (key == GLFW_KEY_W)
-		{
+		if (key == GLFW_KEY_Z ? board->Undo() : board->Redo())
+			renderFrame(window);
+		return;
+	}
 
-		}
-		else if (key == GLFW_KEY_A)
-		{
-			board->SetMoveDirection(0, 0);
-		}
-		else if (key == GLFW_KEY_S)
-		{
-			board->SetMoveDirection(0, 0);
-		}
-		else if (key == GLFW_KEY_D)
-		{
-			board->SetMoveDirection(0, 0);
-		}
+	// B hands the game to the bot and back.
+	if (key == GLFW_KEY_B && action == GLFW_PRESS)
+	{
+		board->SetBotEnabled(!board->IsBotEnabled(), time);
+		return;
 	}
-	else if (action == GLFW_REPEAT)
+
+	InputAction input;
+	switch (key)
 	{
-		if (key == GLFW_KEY_A)
-		{
-			board->SetMoveDirection(-1, 0);
-		}
-		else if (key == GLFW_KEY_S)
-		{
-			board->SetMoveDirection(0, -1);
-		}
-		else if (key == GLFW_KEY_D)
-		{
-			board->SetMoveDirection(1, 0);
-		}
+	case GLFW_KEY_A: input = InputAction::LEFT; break;
+	case GLFW_KEY_D: input = InputAction::RIGHT; break;
+	case GLFW_KEY_S: input = InputAction::SOFT_DROP; break;
+	case GLFW_KEY_SPACE: input = InputAction::HARD_DROP; break;
+	case GLFW_KEY_W: input = InputAction::ROTATE_CCW; break;
+	case GLFW_KEY_E: input = InputAction::ROTATE_CW; break;
+	case GLFW_KEY_C: input = InputAction::HOLD; break;
+	default: return;
 	}
+
+	if (action == GLFW_PRESS)
+		board->Press(input, time);
+	else if (action == GLFW_RELEASE)
+		board->Release(input, time);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -87,6 +86,12 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 }
 
+// The window was uncovered or resized and has to be drawn again while the game is idle.
+void window_refresh_callback(GLFWwindow* window)
+{
+	renderFrame(window);
+}
+
 /*
 	Prints the version of openGL on the system using the glfw window in the
 	format X.X.X
@@ -149,6 +154,7 @@ int setupGLFW(GLFWwindow** pWindow, int xSize, int ySize)
 
 	// Set up key processing call_back
 	glfwSetKeyCallback(window, key_callback);
+	glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
 	*pWindow = window;
 
@@ -163,8 +169,23 @@ void cleanupGLFW(GLFWwindow* window)
 	glfwTerminate();
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// A piece set file can be given to play with other pieces than the standard tetrominoes.
+	static PieceSet pieces = c_STANDARD_PIECES;
+	if (argc > 1)
+	{
+		try
+		{
+			pieces = PieceSet::Load(argv[1]);
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cerr << e.what() << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	GLFWwindow* window;
 	unsigned int width, height;
 	width = 1200;
@@ -176,26 +197,52 @@ int main()
 
 	// Create and initialize the buffer
 	Board board(width, height);
+	board.SetPieceSet(&pieces);
 	glfwSetWindowUserPointer(window, &board);
 
 	// Wireframe mode
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+	// The game runs in fixed steps however fast the frames are drawn.
+	FixedStepClock clock(Game::c_TICKS_PER_SECOND);
+	double lastTime = glfwGetTime();
+	unsigned int idleTicks = 0; // Ticks slept through on purpose since the last time round
+
 	// Main game loop
 	while (!glfwWindowShouldClose(window)) {
-		glClear(GL_COLOR_BUFFER_BIT);
-		
-		// Poll for and process events 
-		glfwPollEvents();
-
-		// Update the board
-		board.Update();
-
-		// Render to the screen
-		board.Render();
-		
-		// Swap front and back buffers 
-		glfwSwapBuffers(window);
+		// Update the board once for every tick that has elapsed since the last time round
+		double now = glfwGetTime();
+		unsigned int ticks = clock.Advance(now - lastTime, idleTicks);
+		lastTime = now;
+
+		// The time each tick ended, so input is applied in the tick it happened in rather than the frame it was seen in.
+		double tickEnd = now - (clock.GetAlpha() + ticks) * clock.GetTickLength();
+		for (unsigned int i = 0; i < ticks; i++)
+		{
+			tickEnd += clock.GetTickLength();
+			board.Update(tickEnd);
+		}
+
+		// Render to the screen, nothing can have changed if no tick ran.
+		if (ticks > 0)
+			renderFrame(window);
+
+		// Sleep until the next tick that does something, e.g. a row of gravity or a
+		// lock, or until input arrives. An idle game costs next to no CPU.
+		idleTicks = board.GetTicksUntilUpdate();
+		if (idleTicks == Game::c_NO_DEADLINE)
+		{
+			idleTicks = 0;
+			glfwWaitEvents();
+		}
+		else
+		{
+			double timeout = clock.GetTimeUntil(idleTicks);
+			if (timeout > 0.0)
+				glfwWaitEventsTimeout(timeout);
+			else
+				glfwPollEvents();
+		}
 	}
 
 	cleanupGLFW(window);
@@ -0,0 +1,251 @@
+#include "input.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+InputHandler::InputHandler(Game* game)
+{
+	m_game = game;
+	m_handling = c_DEFAULT_HANDLING;
+	m_firstEvent = 0;
+	m_numEvents = 0;
+	m_time = 0.0;
+	m_direction = 0;
+	m_nextShift = 0.0;
+	m_softDropRows = 0.0;
+
+	for (unsigned int i = 0; i < c_NUM_INPUT_ACTIONS; i++)
+	{
+		m_held[i] = false;
+	}
+}
+
+void InputHandler::SetHandling(const HandlingSettings& handling)
+{
+	m_handling = handling;
+}
+
+const HandlingSettings& InputHandler::GetHandling() const
+{
+	return m_handling;
+}
+
+void InputHandler::Press(InputAction action, double time)
+{
+	Queue(action, true, time);
+}
+
+void InputHandler::Release(InputAction action, double time)
+{
+	Queue(action, false, time);
+}
+
+void InputHandler::Queue(InputAction action, bool pressed, double time)
+{
+	// A lost release would leave DAS or soft drop running until the key is pressed again, so only presses are given up.
+	if (m_numEvents == c_MAX_EVENTS && !MakeRoom(!pressed))
+		return;
+
+	// Events come in the order they happened, so the queue stays sorted by time.
+	Event& event = m_events[(m_firstEvent + m_numEvents) % c_MAX_EVENTS];
+	event.time = time;
+	event.action = action;
+	event.pressed = pressed;
+	m_numEvents++;
+}
+
+bool InputHandler::MakeRoom(bool forRelease)
+{
+	static_assert(c_NUM_INPUT_ACTIONS < c_MAX_EVENTS, "A full queue of releases must repeat one, so there is always room for another");
+
+	bool held[c_NUM_INPUT_ACTIONS];
+	std::copy(m_held, m_held + c_NUM_INPUT_ACTIONS, held);
+
+	// First choice is an event that changes nothing, a press of a key already held or a release of one that isn't.
+	// Failing that a release takes the place of the oldest press, a press waits its turn and is dropped itself.
+	unsigned int drop = c_MAX_EVENTS;
+	for (unsigned int i = 0; i < m_numEvents; i++)
+	{
+		const Event& event = m_events[(m_firstEvent + i) % c_MAX_EVENTS];
+		const unsigned int index = static_cast<unsigned int>(event.action);
+		if (held[index] == event.pressed)
+		{
+			drop = i;
+			break;
+		}
+
+		held[index] = event.pressed;
+		if (forRelease && event.pressed && drop == c_MAX_EVENTS)
+			drop = i;
+	}
+
+	if (drop == c_MAX_EVENTS)
+		return false;
+
+	for (unsigned int i = drop; i + 1 < m_numEvents; i++)
+	{
+		m_events[(m_firstEvent + i) % c_MAX_EVENTS] = m_events[(m_firstEvent + i + 1) % c_MAX_EVENTS];
+	}
+
+	m_numEvents--;
+	return true;
+}
+
+void InputHandler::Update(double time)
+{
+	while (m_numEvents > 0 && m_events[m_firstEvent].time < time)
+	{
+		const Event& event = m_events[m_firstEvent];
+
+		AdvanceTo(event.time);
+		Apply(event);
+
+		m_firstEvent = (m_firstEvent + 1) % c_MAX_EVENTS;
+		m_numEvents--;
+	}
+
+	AdvanceTo(time);
+}
+
+unsigned int InputHandler::GetTicksUntilUpdate() const
+{
+	double deadline = std::numeric_limits<double>::infinity();
+
+	if (m_numEvents > 0)
+		deadline = m_events[m_firstEvent].time;
+
+	// With an ARR of 0 the shift to the wall is redone on every update, which needs no wake up of its own.
+	if (m_direction != 0 && m_nextShift > m_time)
+		deadline = std::fmin(deadline, m_nextShift);
+
+	if (m_held[static_cast<unsigned int>(InputAction::SOFT_DROP)])
+	{
+		const double rate = m_game->GetGravity() * Game::c_TICKS_PER_SECOND * m_handling.softDropFactor;
+		if (!std::isinf(rate))
+			deadline = std::fmin(deadline, m_time + (1.0 - m_softDropRows) / rate);
+	}
+
+	if (std::isinf(deadline))
+		return Game::c_NO_DEADLINE;
+
+	// Updates come at the end of each tick, the first one at or after the deadline handles it.
+	const double ticks = std::ceil((deadline - m_time) * Game::c_TICKS_PER_SECOND);
+	if (ticks < 1.0)
+		return 1;
+	if (ticks >= Game::c_NO_DEADLINE)
+		return Game::c_NO_DEADLINE - 1;
+
+	return static_cast<unsigned int>(ticks);
+}
+
+void InputHandler::Apply(const Event& event)
+{
+	const unsigned int index = static_cast<unsigned int>(event.action);
+	const bool wasHeld = m_held[index];
+	m_held[index] = event.pressed;
+
+	if (event.action == InputAction::LEFT || event.action == InputAction::RIGHT)
+	{
+		const int direction = event.action == InputAction::LEFT ? -1 : 1;
+
+		if (event.pressed && !wasHeld)
+		{
+			// The last direction pressed wins, it shifts once straight away and then charges DAS.
+			m_direction = direction;
+			m_nextShift = m_time + m_handling.das;
+			Shift(direction, 1);
+		}
+		else if (!event.pressed && m_direction == direction)
+		{
+			// Fall back to the other direction if it is still held, charging DAS again.
+			const InputAction other = direction < 0 ? InputAction::RIGHT : InputAction::LEFT;
+			m_direction = m_held[static_cast<unsigned int>(other)] ? -direction : 0;
+			m_nextShift = m_time + m_handling.das;
+		}
+		return;
+	}
+
+	if (!event.pressed || wasHeld)
+	{
+		if (event.action == InputAction::SOFT_DROP && !event.pressed)
+			m_softDropRows = 0.0;
+		return;
+	}
+
+	switch (event.action)
+	{
+	case InputAction::HARD_DROP:
+		m_game->HardDrop();
+		break;
+	case InputAction::ROTATE_CW:
+		m_game->RotatePiece(1);
+		break;
+	case InputAction::ROTATE_CCW:
+		m_game->RotatePiece(-1);
+		break;
+	case InputAction::HOLD:
+		m_game->HoldPiece();
+		break;
+	default:
+		break;
+	}
+}
+
+void InputHandler::AdvanceTo(double time)
+{
+	// Events from before the last update are applied as soon as they are seen.
+	if (time <= m_time)
+		return;
+
+	const double elapsed = time - m_time;
+	m_time = time;
+
+	if (m_direction != 0 && m_time >= m_nextShift)
+	{
+		if (m_handling.arr <= 0.0)
+		{
+			// Keep the piece against the wall, new pieces included, for as long as the key is held.
+			Shift(m_direction, Playfield::c_NUM_COLS);
+		}
+		else
+		{
+			// Every repeat that fell due since the last update, at its own time rather than once per frame.
+			const unsigned int shifts = static_cast<unsigned int>((m_time - m_nextShift) / m_handling.arr) + 1;
+			m_nextShift += shifts * m_handling.arr;
+			Shift(m_direction, shifts);
+		}
+	}
+
+	if (m_held[static_cast<unsigned int>(InputAction::SOFT_DROP)])
+	{
+		const double rate = m_game->GetGravity() * Game::c_TICKS_PER_SECOND * m_handling.softDropFactor;
+
+		if (std::isinf(rate))
+		{
+			m_game->DropPiece(Playfield::c_NUM_ROWS);
+		}
+		else
+		{
+			m_softDropRows += elapsed * rate;
+			const int rows = static_cast<int>(m_softDropRows);
+
+			// Soft drop does not build up while the piece is resting on the stack.
+			if (rows > 0 && m_game->DropPiece(rows) < rows)
+				m_softDropRows = 0.0;
+			else
+				m_softDropRows -= rows;
+		}
+	}
+}
+
+void InputHandler::Shift(int direction, unsigned int times)
+{
+	if (times > Playfield::c_NUM_COLS)
+		times = Playfield::c_NUM_COLS;
+
+	for (unsigned int i = 0; i < times; i++)
+	{
+		if (!m_game->MovePiece(direction, 0))
+			break;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include "game.h"
+
+enum class InputAction : uint8_t
+{
+	LEFT,
+	RIGHT,
+	SOFT_DROP,
+	HARD_DROP,
+	ROTATE_CW,
+	ROTATE_CCW,
+	HOLD
+};
+
+static constexpr unsigned int c_NUM_INPUT_ACTIONS = 7;
+
+/*
+	How the falling piece responds to held keys, all times in seconds.
+*/
+struct HandlingSettings
+{
+	double das;            // Delayed auto shift, how long left or right is held before it repeats
+	double arr;            // Auto repeat rate, time between repeated shifts. 0 shifts to the wall instantly
+	double softDropFactor; // Soft drop speed as a multiple of gravity. Infinity drops to the stack instantly
+};
+
+inline constexpr HandlingSettings c_DEFAULT_HANDLING = { 10.0 / 60.0, 2.0 / 60.0, 20.0 };
+
+/*
+	Turns timestamped presses and releases into moves of the falling piece. Each
+	event is applied at the time it happened rather than the frame it was seen
+	in, and auto shift and soft drop are worked out from the times themselves,
+	so the speed of a held key does not depend on the OS key repeat or on how
+	fast frames are drawn.
+
+	Call Update with the time at the end of each tick before ticking the game.
+	Timestamps can be from any clock as long as Update uses the same one.
+*/
+class InputHandler
+{
+public:
+	InputHandler(Game* game);
+
+	void SetHandling(const HandlingSettings& handling);
+	const HandlingSettings& GetHandling() const;
+
+	void Press(InputAction action, double time);
+	void Release(InputAction action, double time);
+
+	// Applies every event and auto shift up to time, holding back events that happened after it.
+	void Update(double time);
+
+	// Ticks until the first update that has an event, auto shift or soft drop row due, Game::c_NO_DEADLINE if none.
+	unsigned int GetTicksUntilUpdate() const;
+
+private:
+	struct Event
+	{
+		double time;
+		InputAction action;
+		bool pressed;
+	};
+
+	// Events seen between two ticks. Past this, presses are dropped to make room but releases never are.
+	static constexpr unsigned int c_MAX_EVENTS = 64;
+
+	void Queue(InputAction action, bool pressed, double time);
+	bool MakeRoom(bool forRelease);
+	void Apply(const Event& event);
+	void AdvanceTo(double time);
+	void Shift(int direction, unsigned int times);
+
+	Game* m_game;
+	HandlingSettings m_handling;
+
+	Event m_events[c_MAX_EVENTS];
+	unsigned int m_firstEvent;
+	unsigned int m_numEvents;
+
+	double m_time; // Input has been applied up to here
+	bool m_held[c_NUM_INPUT_ACTIONS];
+
+	int m_direction;      // -1 or 1 for the shift key pressed last and still held, 0 for none
+	double m_nextShift;   // Time of the next auto shift
+	double m_softDropRows; // Part of a row of soft drop carried over to the next update
+};
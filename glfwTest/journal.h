@@ -0,0 +1,206 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "bits.h"
+
+/*
+	Undo and redo history of a fixed size state, e.g. a GameState, recorded once
+	per piece. Each step keeps only the 8 byte words of the state that changed,
+	XORed old with new, so the same delta takes the state back or forward.
+
+	A locked piece changes a few words of the playfield (four rows each on the
+	standard board) and of the queue, randomizer and counters, so stepping costs
+	O(changed rows) rather than a copy of the whole state. Long replays can be
+	scrubbed through one step at a time with Seek.
+*/
+template <typename State>
+class Journal
+{
+public:
+	static_assert(std::is_trivially_copyable<State>::value, "Journal states are XORed as raw bytes");
+
+	Journal();
+
+	// Clears the history, state being where it starts.
+	void Reset(const State& state);
+
+	// Adds a step to state from the current one, dropping anything that could have been redone.
+	void Record(const State& state);
+
+	bool CanUndo() const;
+	bool CanRedo() const;
+	bool Undo();
+	bool Redo();
+
+	// Steps back or forward to after the given number of recorded steps, clamped to the history.
+	void Seek(size_t position);
+
+	size_t GetPosition() const;
+	size_t GetLength() const;
+
+	// The state at the current position.
+	const State& GetState() const;
+
+private:
+	static constexpr unsigned int c_NUM_WORDS = (sizeof(State) + 7) / 8;
+	static_assert(c_NUM_WORDS <= 64, "Journal states must fit in 64 words");
+
+	struct Step
+	{
+		uint64_t changed;  // Bit n is set if word n of the state changed
+		uint32_t firstDelta; // Where the XORs of the changed words start in m_deltas
+	};
+
+	void Apply(const Step& step);
+	static uint64_t GetWord(const State& state, unsigned int word);
+	static void SetWord(State& state, unsigned int word, uint64_t value);
+
+	State m_state;
+	std::vector<Step> m_steps;
+	std::vector<uint64_t> m_deltas;
+	size_t m_position; // Steps recorded up to the current state
+};
+
+template <typename State>
+Journal<State>::Journal()
+	: m_state()
+{
+	m_position = 0;
+}
+
+template <typename State>
+void Journal<State>::Reset(const State& state)
+{
+	m_state = state;
+	m_steps.clear();
+	m_deltas.clear();
+	m_position = 0;
+}
+
+template <typename State>
+void Journal<State>::Record(const State& state)
+{
+	// A new step after undoing starts a new branch, the old one can't be redone.
+	if (m_position < m_steps.size())
+	{
+		m_deltas.resize(m_steps[m_position].firstDelta);
+		m_steps.resize(m_position);
+	}
+
+	Step step;
+	step.changed = 0;
+	step.firstDelta = static_cast<uint32_t>(m_deltas.size());
+
+	for (unsigned int i = 0; i < c_NUM_WORDS; i++)
+	{
+		const uint64_t delta = GetWord(m_state, i) ^ GetWord(state, i);
+		if (delta != 0)
+		{
+			step.changed |= 1ull << i;
+			m_deltas.push_back(delta);
+		}
+	}
+
+	m_steps.push_back(step);
+	m_position++;
+	m_state = state;
+}
+
+template <typename State>
+bool Journal<State>::CanUndo() const
+{
+	return m_position > 0;
+}
+
+template <typename State>
+bool Journal<State>::CanRedo() const
+{
+	return m_position < m_steps.size();
+}
+
+template <typename State>
+bool Journal<State>::Undo()
+{
+	if (!CanUndo())
+		return false;
+
+	Apply(m_steps[--m_position]);
+	return true;
+}
+
+template <typename State>
+bool Journal<State>::Redo()
+{
+	if (!CanRedo())
+		return false;
+
+	Apply(m_steps[m_position++]);
+	return true;
+}
+
+template <typename State>
+void Journal<State>::Seek(size_t position)
+{
+	if (position > m_steps.size())
+		position = m_steps.size();
+
+	while (m_position > position)
+		Undo();
+
+	while (m_position < position)
+		Redo();
+}
+
+template <typename State>
+size_t Journal<State>::GetPosition() const
+{
+	return m_position;
+}
+
+template <typename State>
+size_t Journal<State>::GetLength() const
+{
+	return m_steps.size();
+}
+
+template <typename State>
+const State& Journal<State>::GetState() const
+{
+	return m_state;
+}
+
+template <typename State>
+void Journal<State>::Apply(const Step& step)
+{
+	const uint64_t* delta = &m_deltas[step.firstDelta];
+
+	// Only the changed words are touched, one per set bit.
+	for (uint64_t changed = step.changed; changed != 0; changed &= changed - 1)
+	{
+		const unsigned int word = CountTrailingZeros64(changed);
+		SetWord(m_state, word, GetWord(m_state, word) ^ *delta++);
+	}
+}
+
+template <typename State>
+uint64_t Journal<State>::GetWord(const State& state, unsigned int word)
+{
+	// The last word of a state whose size is not a multiple of 8 is padded with zeros.
+	const size_t offset = word * 8;
+	const size_t size = sizeof(State) - offset < 8 ? sizeof(State) - offset : 8;
+
+	uint64_t value = 0;
+	std::memcpy(&value, reinterpret_cast<const unsigned char*>(&state) + offset, size);
+	return value;
+}
+
+template <typename State>
+void Journal<State>::SetWord(State& state, unsigned int word, uint64_t value)
+{
+	const size_t offset = word * 8;
+	const size_t size = sizeof(State) - offset < 8 ? sizeof(State) - offset : 8;
+
+	std::memcpy(reinterpret_cast<unsigned char*>(&state) + offset, &value, size);
+}
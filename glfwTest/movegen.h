@@ -0,0 +1,448 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "piece.h"
+#include "playfield.h"
+#include "spin.h"
+#include "bits.h"
+
+/*
+	Where a piece can come to rest: the piece as it would lock and the spin
+	locking it there scores.
+*/
+struct Placement
+{
+	PieceState piece;
+	SpinType spin;
+};
+
+/*
+	Lists every placement a piece can reach from where it is by shifting, soft
+	dropping and rotating with kicks, for bots to choose from.
+
+	Rather than testing one (x, y, rotation) state at a time, each row of the
+	search is a 64 bit mask of box positions, bit x + c_OFFSET for column x. The
+	positions the piece fits at are worked out once per rotation and row from the
+	playfield rows, then a flood fill spreads the reached positions along each row
+	with shifts, down into the row below, and through the kick tables into the
+	other rotations, a whole row of positions per step.
+
+	Placements with the same blocks, e.g. the two flat positions of an I piece,
+	are listed once. Holds buffers for the search, so keep one per thread.
+*/
+template <unsigned int Cols, unsigned int Rows>
+class BasicMoveGenerator
+{
+public:
+	using Field = BasicPlayfield<Cols, Rows>;
+
+	// Box positions can start up to c_OFFSET columns left of and rows above the board.
+	static constexpr unsigned int c_OFFSET = c_MAX_BOX_SIZE - 1;
+	static constexpr unsigned int c_NUM_X = Cols + c_OFFSET;
+	static constexpr unsigned int c_NUM_Y = Rows + c_OFFSET;
+
+	// Enough for every box position of every rotation, far more than a real board has.
+	static constexpr unsigned int c_MAX_PLACEMENTS = c_NUM_ROTATIONS * c_NUM_X * c_NUM_Y;
+
+	static_assert(Cols + 2 * c_OFFSET <= 64, "The move generator needs a box position row to fit in 64 bits");
+	static_assert(c_NUM_Y <= 64, "The move generator keeps a 64 bit mask of rows to visit");
+
+	/*
+		Fills placements with everything the piece can reach and lock at, returns
+		how many there are, 0 if the piece does not fit where it is. placements must
+		have room for c_MAX_PLACEMENTS.
+	*/
+	unsigned int Generate(const Field& field, const PieceState& piece, const PieceSet& pieces, SpinRule rule, Placement* placements);
+
+private:
+	static constexpr uint64_t c_VALID_POSITIONS = (1ull << c_NUM_X) - 1;
+
+	static uint64_t Shift(uint64_t positions, int x);
+	static uint64_t FillRow(uint64_t seeds, uint64_t free);
+	static bool IsSameShape(const PieceRotation& a, const PieceRotation& b);
+
+	void FindFreePositions(const Field& field, PieceType type, const PieceSet& pieces);
+	void Search(const PieceState& piece, const PieceSet& pieces);
+	void FillSky(const PieceState& piece, const PieceSet& pieces, uint64_t* pending);
+	void Reach(unsigned int rotation, unsigned int row, uint64_t positions, uint64_t* pending);
+	void FindSpins(const Field& field, PieceType type, const PieceSet& pieces, SpinRule rule);
+	void RemoveDuplicates(PieceType type, const PieceSet& pieces);
+
+	// All indexed by [rotation][y + c_OFFSET], bit x + c_OFFSET. Free has an extra row below the board that is never free.
+	uint64_t m_free[c_NUM_ROTATIONS][c_NUM_Y + 1];
+	uint64_t m_reached[c_NUM_ROTATIONS][c_NUM_Y];
+	uint64_t m_expanded[c_NUM_ROTATIONS][c_NUM_Y]; // Reached positions already shifted, dropped and rotated from
+	uint64_t m_rotated[c_NUM_ROTATIONS][c_NUM_Y];  // Reached by a rotation
+	uint64_t m_lastKick[c_NUM_ROTATIONS][c_NUM_Y]; // Reached by a rotation using the last kick
+	uint64_t m_landed[c_NUM_ROTATIONS][c_NUM_Y];
+	uint64_t m_mini[c_NUM_ROTATIONS][c_NUM_Y];
+	uint64_t m_full[c_NUM_ROTATIONS][c_NUM_Y];
+	unsigned int m_stackTop; // First row of the board with any blocks in it
+};
+
+using MoveGenerator = BasicMoveGenerator<Playfield::c_NUM_COLS, Playfield::c_NUM_ROWS>;
+
+template <unsigned int Cols, unsigned int Rows>
+unsigned int BasicMoveGenerator<Cols, Rows>::Generate(const Field& field, const PieceState& piece, const PieceSet& pieces, SpinRule rule, Placement* placements)
+{
+	if (field.Collides(piece, pieces))
+		return 0;
+
+	FindFreePositions(field, piece.type, pieces);
+	Search(piece, pieces);
+
+	// A piece has landed where it can not move down any further.
+	for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		for (unsigned int row = 0; row < c_NUM_Y; row++)
+		{
+			m_landed[rotation][row] = m_reached[rotation][row] & ~m_free[rotation][row + 1];
+		}
+	}
+
+	FindSpins(field, piece.type, pieces, rule);
+	RemoveDuplicates(piece.type, pieces);
+
+	unsigned int count = 0;
+	for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		for (unsigned int row = 0; row < c_NUM_Y; row++)
+		{
+			for (uint64_t landed = m_landed[rotation][row]; landed != 0; landed &= landed - 1)
+			{
+				const unsigned int x = CountTrailingZeros64(landed);
+				const uint64_t bit = 1ull << x;
+
+				Placement& placement = placements[count++];
+				placement.piece.type = piece.type;
+				placement.piece.rotation = static_cast<uint8_t>(rotation);
+				placement.piece.x = static_cast<int8_t>(static_cast<int>(x) - static_cast<int>(c_OFFSET));
+				placement.piece.y = static_cast<int8_t>(static_cast<int>(row) - static_cast<int>(c_OFFSET));
+				placement.spin = (m_full[rotation][row] & bit) ? SpinType::FULL :
+					(m_mini[rotation][row] & bit) ? SpinType::MINI : SpinType::NONE;
+			}
+		}
+	}
+
+	return count;
+}
+
+// Moves box positions x columns right, or left if x is negative.
+template <unsigned int Cols, unsigned int Rows>
+inline uint64_t BasicMoveGenerator<Cols, Rows>::Shift(uint64_t positions, int x)
+{
+	return x >= 0 ? positions << x : positions >> -x;
+}
+
+// Spreads the seeds left and right through the free positions, i.e. every position reachable by shifting.
+template <unsigned int Cols, unsigned int Rows>
+inline uint64_t BasicMoveGenerator<Cols, Rows>::FillRow(uint64_t seeds, uint64_t free)
+{
+	uint64_t left = seeds, leftRun = free;
+	uint64_t right = seeds, rightRun = free;
+
+	for (unsigned int shift = 1; shift < c_NUM_X; shift *= 2)
+	{
+		left |= leftRun & (left << shift);
+		leftRun &= leftRun << shift;
+		right |= rightRun & (right >> shift);
+		rightRun &= rightRun >> shift;
+	}
+
+	return left | right;
+}
+
+// True if the two rotations have the same blocks, only moved inside the box.
+template <unsigned int Cols, unsigned int Rows>
+bool BasicMoveGenerator<Cols, Rows>::IsSameShape(const PieceRotation& a, const PieceRotation& b)
+{
+	if (a.maxRow - a.minRow != b.maxRow - b.minRow || a.maxCol - a.minCol != b.maxCol - b.minCol)
+		return false;
+
+	for (int row = 0; row <= a.maxRow - a.minRow; row++)
+	{
+		if ((a.rowMasks[a.minRow + row] >> a.minCol) != (b.rowMasks[b.minRow + row] >> b.minCol))
+			return false;
+	}
+
+	return true;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicMoveGenerator<Cols, Rows>::FindFreePositions(const Field& field, PieceType type, const PieceSet& pieces)
+{
+	// Blocked columns of every row a box can cover, walls and the rows off the board included.
+	uint64_t blocked[Rows + 2 * c_OFFSET];
+	for (unsigned int i = 0; i < Rows + 2 * c_OFFSET; i++)
+	{
+		const int row = static_cast<int>(i) - static_cast<int>(c_OFFSET);
+		if (row < 0 || row >= static_cast<int>(Rows))
+			blocked[i] = ~0ull;
+		else
+			blocked[i] = (static_cast<uint64_t>(field.GetRow(row)) << c_OFFSET) | ~(static_cast<uint64_t>(Field::c_FULL_ROW) << c_OFFSET);
+	}
+
+	// The first row with any blocks in it, rows above it only have the walls to collide with.
+	unsigned int stackTop = 0;
+	while (stackTop < Rows && field.GetRow(stackTop) == 0)
+		stackTop++;
+
+	m_stackTop = stackTop;
+
+	// A block at box column col collides at every position col columns left of a blocked cell.
+	for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		const PieceRotation& shape = pieces.GetRotation(type, rotation);
+
+		const uint64_t walls = ~(static_cast<uint64_t>(Field::c_FULL_ROW) << c_OFFSET);
+		uint64_t wallsOnly = 0;
+		for (int boxRow = shape.minRow; boxRow <= shape.maxRow; boxRow++)
+		{
+			for (uint32_t mask = shape.rowMasks[boxRow]; mask != 0; mask &= mask - 1)
+			{
+				wallsOnly |= walls >> CountTrailingZeros(mask);
+			}
+		}
+
+		for (unsigned int row = 0; row < c_NUM_Y; row++)
+		{
+			const int top = static_cast<int>(row) - static_cast<int>(c_OFFSET) + shape.minRow;
+			const int bottom = static_cast<int>(row) - static_cast<int>(c_OFFSET) + shape.maxRow;
+
+			if (top < 0 || bottom >= static_cast<int>(Rows))
+			{
+				m_free[rotation][row] = 0;
+				continue;
+			}
+
+			if (bottom < static_cast<int>(stackTop))
+			{
+				m_free[rotation][row] = c_VALID_POSITIONS & ~wallsOnly;
+				continue;
+			}
+
+			uint64_t collides = 0;
+			for (int boxRow = shape.minRow; boxRow <= shape.maxRow; boxRow++)
+			{
+				const uint64_t cells = blocked[row + boxRow];
+				for (uint32_t mask = shape.rowMasks[boxRow]; mask != 0; mask &= mask - 1)
+				{
+					collides |= cells >> CountTrailingZeros(mask);
+				}
+			}
+
+			m_free[rotation][row] = c_VALID_POSITIONS & ~collides;
+		}
+
+		m_free[rotation][c_NUM_Y] = 0;
+	}
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicMoveGenerator<Cols, Rows>::Search(const PieceState& piece, const PieceSet& pieces)
+{
+	std::memset(m_reached, 0, sizeof(m_reached));
+	std::memset(m_expanded, 0, sizeof(m_expanded));
+	std::memset(m_rotated, 0, sizeof(m_rotated));
+	std::memset(m_lastKick, 0, sizeof(m_lastKick));
+
+	// Rows with newly reached positions still to spread from, bit row for each rotation.
+	uint64_t pending[c_NUM_ROTATIONS] = {};
+	Reach(piece.rotation, piece.y + c_OFFSET, 1ull << (piece.x + c_OFFSET), pending);
+	FillSky(piece, pieces, pending);
+
+	bool done = false;
+	while (!done)
+	{
+		done = true;
+		for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+		{
+			// Top to bottom so rows are mostly finished before the ones below are visited.
+			while (pending[rotation] != 0)
+			{
+				done = false;
+				const unsigned int row = CountTrailingZeros64(pending[rotation]);
+				pending[rotation] &= pending[rotation] - 1;
+
+				// Only positions not moved on from by an earlier visit to the row need expanding.
+				const uint64_t filled = FillRow(m_reached[rotation][row], m_free[rotation][row]);
+				const uint64_t reached = filled & ~m_expanded[rotation][row];
+				m_reached[rotation][row] = filled;
+				m_expanded[rotation][row] = filled;
+
+				// Soft drop.
+				if (row + 1 < c_NUM_Y)
+					Reach(rotation, row + 1, reached & m_free[rotation][row + 1], pending);
+
+				// Rotations, each position using the first kick that fits.
+				for (int direction = -1; direction <= 1; direction += 2)
+				{
+					const unsigned int to = (rotation + direction) & 3;
+					const Kick* kicks = pieces.GetKicks(piece.type, rotation, direction);
+
+					uint64_t remaining = reached;
+					for (unsigned int i = 0; i < c_NUM_KICKS && remaining != 0; i++)
+					{
+						// Kicks count rows upwards, positions off the board never fit.
+						const int toRow = static_cast<int>(row) - kicks[i].y;
+						if (toRow < 0 || toRow >= static_cast<int>(c_NUM_Y))
+							continue;
+
+						const uint64_t fits = remaining & Shift(m_free[to][toRow], -kicks[i].x);
+						remaining &= ~fits;
+
+						const uint64_t rotated = Shift(fits, kicks[i].x);
+						m_rotated[to][toRow] |= rotated;
+						if (i == c_NUM_KICKS - 1)
+							m_lastKick[to][toRow] |= rotated;
+
+						Reach(to, toRow, rotated, pending);
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+	Fills in the rows above the stack without searching them. Where every rotation
+	is clear of the stack, the row below included, a piece can shift between the
+	walls and turn in place, so from the starting row down every position between
+	the walls is reached in every rotation, and nothing can land there. Only the
+	last rows, that a drop or a kick can leave, are left for the search to move on
+	from. Needs the first kick of every rotation to be no kick, as it is in SRS.
+*/
+template <unsigned int Cols, unsigned int Rows>
+void BasicMoveGenerator<Cols, Rows>::FillSky(const PieceState& piece, const PieceSet& pieces, uint64_t* pending)
+{
+	const unsigned int index = static_cast<unsigned int>(piece.type);
+	if (pieces.boxSizes[index] > static_cast<int>(Cols))
+		return;
+
+	// Rows where every rotation is on the board and clear of the stack.
+	int firstSkyRow = 0;
+	int lastSkyRow = static_cast<int>(c_NUM_Y) - 1;
+	int kickDown = 0;
+	for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		const PieceRotation& shape = pieces.GetRotation(piece.type, rotation);
+		const int first = static_cast<int>(c_OFFSET) - shape.minRow;
+		const int last = static_cast<int>(m_stackTop + c_OFFSET) - 2 - shape.maxRow;
+		firstSkyRow = first > firstSkyRow ? first : firstSkyRow;
+		lastSkyRow = last < lastSkyRow ? last : lastSkyRow;
+
+		for (int direction = -1; direction <= 1; direction += 2)
+		{
+			const Kick* kicks = pieces.GetKicks(piece.type, rotation, direction);
+			if (kicks[0].x != 0 || kicks[0].y != 0)
+				return;
+
+			for (unsigned int i = 0; i < c_NUM_KICKS; i++)
+			{
+				kickDown = -kicks[i].y > kickDown ? -kicks[i].y : kickDown;
+			}
+		}
+	}
+
+	const int startRow = piece.y + static_cast<int>(c_OFFSET);
+	if (startRow < firstSkyRow || startRow + kickDown >= lastSkyRow)
+		return;
+
+	// Drops and kicks out of the rows above lastDoneRow end up in the sky again, so those rows are done.
+	const int lastDoneRow = lastSkyRow - kickDown - 1;
+	for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		pending[rotation] = 0;
+		for (int row = startRow; row <= lastSkyRow; row++)
+		{
+			m_reached[rotation][row] = m_free[rotation][row];
+			if (row <= lastDoneRow)
+				m_expanded[rotation][row] = m_free[rotation][row];
+			else
+				pending[rotation] |= 1ull << row;
+		}
+	}
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline void BasicMoveGenerator<Cols, Rows>::Reach(unsigned int rotation, unsigned int row, uint64_t positions, uint64_t* pending)
+{
+	const uint64_t added = positions & ~m_reached[rotation][row];
+	if (added != 0)
+	{
+		m_reached[rotation][row] |= added;
+		pending[rotation] |= 1ull << row;
+	}
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicMoveGenerator<Cols, Rows>::FindSpins(const Field& field, PieceType type, const PieceSet& pieces, SpinRule rule)
+{
+	// Only a piece whose last move was a rotation can spin, so only those are checked.
+	for (unsigned int rotation = 0; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		for (unsigned int row = 0; row < c_NUM_Y; row++)
+		{
+			m_mini[rotation][row] = 0;
+			m_full[rotation][row] = 0;
+
+			for (uint64_t rotated = m_landed[rotation][row] & m_rotated[rotation][row]; rotated != 0; rotated &= rotated - 1)
+			{
+				const unsigned int x = CountTrailingZeros64(rotated);
+				const uint64_t bit = 1ull << x;
+
+				PieceState piece;
+				piece.type = type;
+				piece.rotation = static_cast<uint8_t>(rotation);
+				piece.x = static_cast<int8_t>(static_cast<int>(x) - static_cast<int>(c_OFFSET));
+				piece.y = static_cast<int8_t>(static_cast<int>(row) - static_cast<int>(c_OFFSET));
+
+				// The last kick can only make a spin better, so use it if any rotation got here with it.
+				const uint8_t kick = static_cast<uint8_t>((m_lastKick[rotation][row] & bit) ? c_NUM_KICKS - 1 : 0);
+				const SpinType spin = DetectSpin(field, piece, kick, pieces, rule);
+				if (spin == SpinType::FULL)
+					m_full[rotation][row] |= bit;
+				else if (spin == SpinType::MINI)
+					m_mini[rotation][row] |= bit;
+			}
+		}
+	}
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicMoveGenerator<Cols, Rows>::RemoveDuplicates(PieceType type, const PieceSet& pieces)
+{
+	for (unsigned int rotation = 1; rotation < c_NUM_ROTATIONS; rotation++)
+	{
+		const PieceRotation& shape = pieces.GetRotation(type, rotation);
+		for (unsigned int earlier = 0; earlier < rotation; earlier++)
+		{
+			const PieceRotation& earlierShape = pieces.GetRotation(type, earlier);
+			if (!IsSameShape(shape, earlierShape))
+				continue;
+
+			// The same blocks are at x + dx, y + dy in the earlier rotation.
+			const int dx = shape.minCol - earlierShape.minCol;
+			const int dy = shape.minRow - earlierShape.minRow;
+
+			for (int row = 0; row < static_cast<int>(c_NUM_Y); row++)
+			{
+				const int earlierRow = row + dy;
+				if (earlierRow < 0 || earlierRow >= static_cast<int>(c_NUM_Y))
+					continue;
+
+				const uint64_t both = m_landed[rotation][row] & Shift(m_landed[earlier][earlierRow], -dx);
+				if (both == 0)
+					continue;
+
+				// Keep the earlier rotation unless this one scores a better spin.
+				const uint64_t earlierFull = Shift(m_full[earlier][earlierRow], -dx);
+				const uint64_t earlierMini = Shift(m_mini[earlier][earlierRow], -dx);
+				const uint64_t better = both & ((m_full[rotation][row] & ~earlierFull) | (m_mini[rotation][row] & ~earlierFull & ~earlierMini));
+
+				m_landed[rotation][row] &= ~(both & ~better);
+				m_landed[earlier][earlierRow] &= ~Shift(better, dx);
+			}
+		}
+	}
+}
@@ -0,0 +1,287 @@
+// perft.cpp : Counts the placements reachable from fixed positions, to check and time the move generator.
+//
+// Usage: perft [depth] [piece set file]
+//
+// Like perft in chess engines: every placement of the first piece is made, full
+// rows are cleared, and so on down to the given depth, counting the placements
+// of the last piece. The counts for the standard pieces are checked against
+// known values, so any change to collision, rotation, kicks or line clears that
+// changes what can be reached shows up as a mismatch.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "movegen.h"
+#include "piece.h"
+#include "playfield.h"
+
+/*
+	A starting position: the stack as rows from the top of the stack down to the
+	bottom of the board separated by '/', '#' for a block, and the pieces dealt,
+	repeated for as deep as the count goes. expected holds the counts for the
+	standard pieces at depths 1 to c_NUM_CHECKED_DEPTHS.
+*/
+static constexpr unsigned int c_NUM_CHECKED_DEPTHS = 4;
+
+struct PerftPosition
+{
+	const char* name;
+	const char* stack;
+	const char* queue;
+	uint64_t expected[c_NUM_CHECKED_DEPTHS];
+};
+
+static const PerftPosition c_POSITIONS[] =
+{
+	{ "empty", "", "IOTSZJL", { 17, 153, 5266, 94740 } },
+	{ "tspin", "###......./##...#####/###.######", "TIJLOSZ", { 37, 647, 23282, 859912 } },
+	{ "messy", "##.####.##/###.####.#/####.####./.####.####/#.####.###/##.####.##/###.####.#/####.####.", "LJTZSIO", { 34, 1177, 42299, 783253 } },
+	{ "tall", "....#...../.#####.###/###.######/#####.####/##.#######/########.#/#.########/####.#####/#######.##/###.######/######.###/.#########/#########./##.#######/####.#####/#.########", "ZSTIJLO", { 17, 275, 6554, 63668 } },
+};
+
+static Playfield ParseStack(const char* stack)
+{
+	Playfield field;
+
+	unsigned int numRows = stack[0] == '\0' ? 0 : 1;
+	for (const char* c = stack; *c != '\0'; c++)
+	{
+		if (*c == '/')
+			numRows++;
+	}
+
+	unsigned int row = Playfield::c_NUM_ROWS - numRows;
+	unsigned int col = 0;
+	for (const char* c = stack; *c != '\0'; c++)
+	{
+		if (*c == '/')
+		{
+			row++;
+			col = 0;
+			continue;
+		}
+
+		if (*c == '#')
+			field.SetOccupied(row, col);
+		col++;
+	}
+
+	return field;
+}
+
+// The pieces of the queue by name, or every piece of the set in turn for sets without those names.
+static std::vector<PieceType> MakeQueue(const char* names, unsigned int length, const PieceSet& pieces)
+{
+	std::vector<PieceType> queue;
+	const size_t numNames = std::strlen(names);
+
+	for (unsigned int i = 0; i < length; i++)
+	{
+		PieceType type = static_cast<PieceType>(i % pieces.numTypes);
+		for (unsigned int t = 0; t < pieces.numTypes; t++)
+		{
+			if (pieces.names[t] == names[i % numNames])
+				type = static_cast<PieceType>(t);
+		}
+
+		queue.push_back(type);
+	}
+
+	return queue;
+}
+
+/*
+	Counts placements with its own move generator and placement buffers, one per
+	thread. Positions are copied down the tree so nothing is undone.
+*/
+class Perft
+{
+public:
+	Perft(const PieceSet& pieces, unsigned int maxDepth)
+		: m_pieces(pieces), m_placements(static_cast<size_t>(MoveGenerator::c_MAX_PLACEMENTS) * (maxDepth + 1))
+	{
+	}
+
+	uint64_t Count(const Playfield& field, const PieceType* queue, unsigned int depth)
+	{
+		if (depth == 0)
+			return 1;
+
+		Placement* placements = &m_placements[static_cast<size_t>(MoveGenerator::c_MAX_PLACEMENTS) * depth];
+		const PieceState spawn = SpawnState(queue[0], Playfield::c_NUM_COLS, m_pieces);
+		const unsigned int numPlacements = m_generator.Generate(field, spawn, m_pieces, SpinRule::T_SPIN, placements);
+
+		// The last piece's placements are the leaves, no need to make them.
+		if (depth == 1)
+			return numPlacements;
+
+		uint64_t nodes = 0;
+		for (unsigned int i = 0; i < numPlacements; i++)
+		{
+			nodes += Count(Play(field, placements[i]), queue + 1, depth - 1);
+		}
+
+		return nodes;
+	}
+
+	// Every position after depth pieces, to split the count between threads.
+	void Expand(const Playfield& field, const PieceType* queue, unsigned int depth, std::vector<Playfield>& positions)
+	{
+		if (depth == 0)
+		{
+			positions.push_back(field);
+			return;
+		}
+
+		Placement* placements = &m_placements[static_cast<size_t>(MoveGenerator::c_MAX_PLACEMENTS) * depth];
+		const PieceState spawn = SpawnState(queue[0], Playfield::c_NUM_COLS, m_pieces);
+		const unsigned int numPlacements = m_generator.Generate(field, spawn, m_pieces, SpinRule::T_SPIN, placements);
+
+		for (unsigned int i = 0; i < numPlacements; i++)
+		{
+			Expand(Play(field, placements[i]), queue + 1, depth - 1, positions);
+		}
+	}
+
+private:
+	Playfield Play(const Playfield& field, const Placement& placement) const
+	{
+		Playfield next = field;
+		next.Place(placement.piece, m_pieces);
+		next.ClearFullRows();
+		return next;
+	}
+
+	const PieceSet& m_pieces;
+	MoveGenerator m_generator;
+	std::vector<Placement> m_placements; // c_MAX_PLACEMENTS for each depth
+};
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+	Counts to depth with every hardware thread. The positions a couple of pieces
+	in are shared out through an atomic index so the threads stay busy.
+*/
+static uint64_t CountThreaded(const Playfield& field, const std::vector<PieceType>& queue, unsigned int depth, const PieceSet& pieces, unsigned int numThreads)
+{
+	const unsigned int splitDepth = std::min(depth - 1, 2u);
+
+	std::vector<Playfield> positions;
+	Perft(pieces, depth).Expand(field, queue.data(), splitDepth, positions);
+
+	std::atomic<size_t> next(0);
+	std::atomic<uint64_t> nodes(0);
+	std::vector<std::thread> threads;
+
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back([&]()
+		{
+			std::unique_ptr<Perft> perft(new Perft(pieces, depth));
+			uint64_t count = 0;
+
+			for (size_t task = next++; task < positions.size(); task = next++)
+			{
+				count += perft->Count(positions[task], queue.data() + splitDepth, depth - splitDepth);
+			}
+
+			nodes += count;
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	return nodes;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int depth = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : c_NUM_CHECKED_DEPTHS;
+	if (depth < 1)
+		depth = 1;
+
+	// The known counts are only for the standard pieces.
+	PieceSet pieces = c_STANDARD_PIECES;
+	const bool check = argc <= 2;
+	if (!check)
+	{
+		try
+		{
+			pieces = PieceSet::Load(argv[2]);
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	const unsigned int numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	bool passed = true;
+
+	// Rates in nodes per second, counted on this thread and then through the pool, which can be a single thread too.
+	const std::string pooled = std::to_string(numThreads) + (numThreads == 1 ? " thread" : " threads") + " pooled";
+	std::cout << std::left << std::setw(8) << "position" << std::right << std::setw(7) << "depth" << std::setw(14) << "nodes"
+		<< std::setw(20) << "1 thread" << std::setw(20) << pooled << std::endl;
+
+	for (const PerftPosition& position : c_POSITIONS)
+	{
+		const Playfield field = ParseStack(position.stack);
+		const std::vector<PieceType> queue = MakeQueue(position.queue, depth, pieces);
+		std::unique_ptr<Perft> perft(new Perft(pieces, depth));
+
+		for (unsigned int d = 1; d <= depth; d++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			const uint64_t nodes = perft->Count(field, queue.data(), d);
+			const double seconds = SecondsSince(start);
+
+			std::cout << std::left << std::setw(8) << position.name << std::right << std::setw(7) << d << std::setw(14) << nodes
+				<< std::setw(20) << static_cast<uint64_t>(nodes / std::max(seconds, 1e-9));
+
+			// Only the deepest count is worth spreading over threads.
+			if (d == depth && d > 1)
+			{
+				start = std::chrono::steady_clock::now();
+				const uint64_t threadedNodes = CountThreaded(field, queue, d, pieces, numThreads);
+				const double threadedSeconds = SecondsSince(start);
+
+				std::cout << std::setw(20) << static_cast<uint64_t>(threadedNodes / std::max(threadedSeconds, 1e-9));
+				if (threadedNodes != nodes)
+				{
+					std::cout << "  threaded count " << threadedNodes << " differs";
+					passed = false;
+				}
+			}
+
+			if (check && d <= c_NUM_CHECKED_DEPTHS && nodes != position.expected[d - 1])
+			{
+				std::cout << "  expected " << position.expected[d - 1];
+				passed = false;
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	std::cout << (passed ? "All counts match" : "Counts do not match") << std::endl;
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
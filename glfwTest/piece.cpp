@@ -0,0 +1,148 @@
+#include "piece.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+unsigned int GetPieceCells(const PieceState& piece, Cell cells[c_MAX_PIECE_BLOCKS], const PieceSet& pieces)
+{
+	const PieceRotation& rotation = pieces.GetRotation(piece.type, piece.rotation);
+
+	for (int i = 0; i < rotation.numBlocks; i++)
+	{
+		cells[i].row = piece.y + rotation.blocks[i].row;
+		cells[i].col = piece.x + rotation.blocks[i].col;
+	}
+
+	return rotation.numBlocks;
+}
+
+PieceState SpawnState(PieceType type, unsigned int numCols, const PieceSet& pieces)
+{
+	const PieceRotation& rotation = pieces.GetRotation(type, 0);
+
+	PieceState piece;
+	piece.type = type;
+	piece.rotation = 0;
+	piece.x = static_cast<int8_t>((static_cast<int>(numCols) - pieces.boxSizes[static_cast<int>(type)]) / 2);
+
+	// Raise pieces that do not use the top row of their box, e.g. the I piece, to the top of the board.
+	piece.y = static_cast<int8_t>(-rotation.minRow);
+
+	return piece;
+}
+
+char PieceName(PieceType type, const PieceSet& pieces)
+{
+	return pieces.names[static_cast<int>(type)];
+}
+
+static std::runtime_error LoadError(const char* fileName, unsigned int lineNumber, const char* problem)
+{
+	std::string message = "Could not load pieces from ";
+	message.append(fileName);
+	message.append(" line ");
+	message.append(std::to_string(lineNumber));
+	message.append(": ");
+	message.append(problem);
+
+	return std::runtime_error(message);
+}
+
+PieceSet PieceSet::Load(const char* fileName)
+{
+	std::ifstream file(fileName);
+
+	if (!file.is_open())
+	{
+		// Throw an exception that the file could not be opened.
+		std::string message = "Could not open file: ";
+		message.append(fileName);
+		throw std::runtime_error(message);
+	}
+
+	PieceSet set = {};
+	std::string line;
+	unsigned int lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		// Skip blank lines and comments between pieces.
+		if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+
+		// Each piece starts with: piece <name> <r> <g> <b> <srs | srs-i | none> [kick scale]
+		std::istringstream header(line);
+		std::string keyword, rule;
+		char name;
+		float color[3];
+		int kickScale = 1;
+
+		header >> keyword >> name >> color[0] >> color[1] >> color[2] >> rule;
+		if (!header || keyword != "piece")
+			throw LoadError(fileName, lineNumber, "expected 'piece <name> <r> <g> <b> <kicks>'");
+		if (!(header >> kickScale))
+			kickScale = 1;
+
+		KickRule kickRule;
+		if (rule == "srs")
+			kickRule = KickRule::SRS;
+		else if (rule == "srs-i")
+			kickRule = KickRule::SRS_I;
+		else if (rule == "none")
+			kickRule = KickRule::NONE;
+		else
+			throw LoadError(fileName, lineNumber, "kicks must be srs, srs-i or none");
+
+		if (set.numTypes == c_MAX_PIECE_TYPES)
+			throw LoadError(fileName, lineNumber, "too many pieces");
+
+		// Followed by the spawn orientation as a square of '.' and '#'.
+		PieceShape shape = {};
+		int row = 0;
+		do
+		{
+			if (!std::getline(file, line))
+				throw LoadError(fileName, lineNumber, "piece shape is cut short");
+			lineNumber++;
+
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if (row == 0)
+				shape.boxSize = static_cast<int>(line.size());
+
+			if (shape.boxSize == 0 || shape.boxSize > static_cast<int>(c_MAX_BOX_SIZE))
+				throw LoadError(fileName, lineNumber, "piece shapes must be 1 to 8 blocks wide");
+			if (static_cast<int>(line.size()) != shape.boxSize)
+				throw LoadError(fileName, lineNumber, "piece shapes must be square");
+
+			for (int col = 0; col < shape.boxSize; col++)
+			{
+				if (line[col] == '#')
+				{
+					if (shape.numBlocks == c_MAX_PIECE_BLOCKS)
+						throw LoadError(fileName, lineNumber, "pieces can have at most 16 blocks");
+
+					shape.blocks[shape.numBlocks++] = { row, col };
+				}
+				else if (line[col] != '.')
+				{
+					throw LoadError(fileName, lineNumber, "piece shapes are made of '.' and '#'");
+				}
+			}
+		} while (++row < shape.boxSize);
+
+		if (shape.numBlocks == 0)
+			throw LoadError(fileName, lineNumber, "piece has no blocks");
+
+		set.AddPiece(name, color, shape, kickRule, kickScale);
+	}
+
+	if (set.numTypes == 0)
+		throw LoadError(fileName, lineNumber, "no pieces found");
+
+	return set;
+}
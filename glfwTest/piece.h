@@ -0,0 +1,287 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+/*
+	Index of a piece in its PieceSet. The names are the pieces of the standard set.
+*/
+enum class PieceType : uint8_t
+{
+	O, I, J, L, S, T, Z
+};
+
+static constexpr unsigned int c_NUM_PIECE_TYPES = 7; // Pieces in the standard set
+static constexpr unsigned int c_MAX_PIECE_TYPES = 32;
+static constexpr unsigned int c_NUM_ROTATIONS = 4;
+static constexpr unsigned int c_BLOCKS_PER_PIECE = 4; // Blocks in a standard piece
+static constexpr unsigned int c_MAX_PIECE_BLOCKS = 16;
+static constexpr unsigned int c_MAX_BOX_SIZE = 8;
+static constexpr unsigned int c_NUM_KICKS = 5;
+
+/*
+	Board position of a single block, row 0 being the top of the board.
+*/
+struct Cell
+{
+	int row;
+	int col;
+};
+
+/*
+	The authoritative state of the falling piece. x and y are the column and row
+	of the top left corner of the piece's bounding box, rotation is the number of
+	clockwise quarter turns from the spawn orientation (0 - 3).
+*/
+struct PieceState
+{
+	PieceType type;
+	uint8_t rotation;
+	int8_t x;
+	int8_t y;
+};
+
+/*
+	Spawn orientation of a piece inside its square bounding box.
+*/
+struct PieceShape
+{
+	int boxSize;
+	int numBlocks;
+	Cell blocks[c_MAX_PIECE_BLOCKS]; // {row, col} inside the bounding box
+};
+
+/*
+	One orientation of a piece. rowMasks has a bit set for every block in that row
+	of the bounding box, bit 0 being the left column of the box. The min/max
+	values are the extent of the blocks inside the box, used for bounds checks.
+	tops and bottoms are the highest and lowest block row in each box column,
+	-1 for columns without blocks, used to find where the piece lands.
+*/
+struct PieceRotation
+{
+	uint16_t rowMasks[c_MAX_BOX_SIZE];
+	int minRow, maxRow;
+	int minCol, maxCol;
+	int8_t tops[c_MAX_BOX_SIZE];
+	int8_t bottoms[c_MAX_BOX_SIZE];
+	int numBlocks;
+	Cell blocks[c_MAX_PIECE_BLOCKS];
+};
+
+/*
+	Wall kick offsets tried in order when rotating. x is in columns to the right,
+	y is in rows towards the top of the board, the same as the SRS tables.
+*/
+struct Kick
+{
+	int8_t x;
+	int8_t y;
+};
+
+enum class KickRule : uint8_t
+{
+	NONE,
+	SRS,   // J, L, S, T and Z table
+	SRS_I  // I table
+};
+
+// Spawn orientations in the same order as PieceType, using the SRS bounding boxes.
+inline constexpr PieceShape c_SHAPES[c_NUM_PIECE_TYPES] =
+{
+	{ 2, 4, { {0, 0}, {0, 1}, {1, 0}, {1, 1} } }, // O
+	{ 4, 4, { {1, 0}, {1, 1}, {1, 2}, {1, 3} } }, // I
+	{ 3, 4, { {0, 0}, {1, 0}, {1, 1}, {1, 2} } }, // J
+	{ 3, 4, { {0, 2}, {1, 0}, {1, 1}, {1, 2} } }, // L
+	{ 3, 4, { {0, 1}, {0, 2}, {1, 0}, {1, 1} } }, // S
+	{ 3, 4, { {0, 1}, {1, 0}, {1, 1}, {1, 2} } }, // T
+	{ 3, 4, { {0, 0}, {0, 1}, {1, 1}, {1, 2} } }, // Z
+};
+
+/*
+	SRS wall kicks indexed by [starting rotation][direction][test], direction 0 being a
+	clockwise turn and 1 a counter-clockwise turn. The O piece never needs to kick.
+*/
+inline constexpr Kick c_KICKS_JLSTZ[c_NUM_ROTATIONS][2][c_NUM_KICKS] =
+{
+	{ { {0, 0}, {-1, 0}, {-1,  1}, {0, -2}, {-1, -2} },   // 0 -> R
+	  { {0, 0}, { 1, 0}, { 1,  1}, {0, -2}, { 1, -2} } }, // 0 -> L
+	{ { {0, 0}, { 1, 0}, { 1, -1}, {0,  2}, { 1,  2} },   // R -> 2
+	  { {0, 0}, { 1, 0}, { 1, -1}, {0,  2}, { 1,  2} } }, // R -> 0
+	{ { {0, 0}, { 1, 0}, { 1,  1}, {0, -2}, { 1, -2} },   // 2 -> L
+	  { {0, 0}, {-1, 0}, {-1,  1}, {0, -2}, {-1, -2} } }, // 2 -> R
+	{ { {0, 0}, {-1, 0}, {-1, -1}, {0,  2}, {-1,  2} },   // L -> 0
+	  { {0, 0}, {-1, 0}, {-1, -1}, {0,  2}, {-1,  2} } }, // L -> 2
+};
+
+inline constexpr Kick c_KICKS_I[c_NUM_ROTATIONS][2][c_NUM_KICKS] =
+{
+	{ { {0, 0}, {-2, 0}, { 1, 0}, {-2, -1}, { 1,  2} },   // 0 -> R
+	  { {0, 0}, {-1, 0}, { 2, 0}, {-1,  2}, { 2, -1} } }, // 0 -> L
+	{ { {0, 0}, {-1, 0}, { 2, 0}, {-1,  2}, { 2, -1} },   // R -> 2
+	  { {0, 0}, { 2, 0}, {-1, 0}, { 2,  1}, {-1, -2} } }, // R -> 0
+	{ { {0, 0}, { 2, 0}, {-1, 0}, { 2,  1}, {-1, -2} },   // 2 -> L
+	  { {0, 0}, { 1, 0}, {-2, 0}, { 1, -2}, {-2,  1} } }, // 2 -> R
+	{ { {0, 0}, { 1, 0}, {-2, 0}, { 1, -2}, {-2,  1} },   // L -> 0
+	  { {0, 0}, {-2, 0}, { 1, 0}, {-2, -1}, { 1,  2} } }, // L -> 2
+};
+
+/*
+	Turns the shape clockwise around the centre of its bounding box and works out
+	the row masks and extents of the result. Used at compile time for the standard
+	pieces and when a piece set is loaded for any others.
+*/
+constexpr PieceRotation MakeRotation(const PieceShape& shape, unsigned int turns)
+{
+	PieceRotation rotation = {};
+	const int last = shape.boxSize - 1;
+
+	rotation.minRow = last;
+	rotation.minCol = last;
+	rotation.numBlocks = shape.numBlocks;
+
+	for (unsigned int col = 0; col < c_MAX_BOX_SIZE; col++)
+	{
+		rotation.tops[col] = -1;
+		rotation.bottoms[col] = -1;
+	}
+
+	for (int i = 0; i < shape.numBlocks; i++)
+	{
+		int row = shape.blocks[i].row;
+		int col = shape.blocks[i].col;
+
+		for (unsigned int turn = 0; turn < turns; turn++)
+		{
+			int prevRow = row;
+			row = col;
+			col = last - prevRow;
+		}
+
+		rotation.blocks[i] = { row, col };
+		rotation.rowMasks[row] |= static_cast<uint16_t>(1u << col);
+
+		rotation.minRow = row < rotation.minRow ? row : rotation.minRow;
+		rotation.maxRow = row > rotation.maxRow ? row : rotation.maxRow;
+		rotation.minCol = col < rotation.minCol ? col : rotation.minCol;
+		rotation.maxCol = col > rotation.maxCol ? col : rotation.maxCol;
+
+		if (rotation.tops[col] == -1 || row < rotation.tops[col])
+			rotation.tops[col] = static_cast<int8_t>(row);
+		if (row > rotation.bottoms[col])
+			rotation.bottoms[col] = static_cast<int8_t>(row);
+	}
+
+	return rotation;
+}
+
+/*
+	Every orientation and kick table of a set of pieces, built once so the game only
+	does table lookups. The standard tetrominoes are built at compile time, other
+	sets (pentominoes, big pieces, ...) are loaded from a text file with Load.
+*/
+struct PieceSet
+{
+	unsigned int numTypes;
+	char names[c_MAX_PIECE_TYPES];
+	float colors[c_MAX_PIECE_TYPES][3];
+	int boxSizes[c_MAX_PIECE_TYPES];
+	PieceRotation rotations[c_MAX_PIECE_TYPES][c_NUM_ROTATIONS];
+	Kick kicks[c_MAX_PIECE_TYPES][c_NUM_ROTATIONS][2][c_NUM_KICKS];
+
+	/*
+		Adds a piece, building its four orientations and its kick table, with the
+		kick offsets multiplied by kickScale for scaled up pieces.
+	*/
+	constexpr void AddPiece(char name, const float color[3], const PieceShape& shape, KickRule rule, int kickScale)
+	{
+		const unsigned int type = numTypes++;
+
+		names[type] = name;
+		boxSizes[type] = shape.boxSize;
+		for (unsigned int i = 0; i < 3; i++)
+			colors[type][i] = color[i];
+
+		for (unsigned int turns = 0; turns < c_NUM_ROTATIONS; turns++)
+		{
+			rotations[type][turns] = MakeRotation(shape, turns);
+
+			for (unsigned int dir = 0; dir < 2; dir++)
+			{
+				for (unsigned int i = 0; i < c_NUM_KICKS; i++)
+				{
+					Kick kick = {};
+					if (rule == KickRule::SRS)
+						kick = c_KICKS_JLSTZ[turns][dir][i];
+					else if (rule == KickRule::SRS_I)
+						kick = c_KICKS_I[turns][dir][i];
+
+					kicks[type][turns][dir][i] = { static_cast<int8_t>(kick.x * kickScale), static_cast<int8_t>(kick.y * kickScale) };
+				}
+			}
+		}
+	}
+
+	const PieceRotation& GetRotation(PieceType type, unsigned int rotation) const
+	{
+		return rotations[static_cast<unsigned int>(type)][rotation & 3];
+	}
+
+	/*
+		Returns the kicks to try when turning the piece from its current rotation,
+		direction being 1 for clockwise and -1 for counter-clockwise.
+	*/
+	const Kick* GetKicks(PieceType type, unsigned int rotation, int direction) const
+	{
+		return kicks[static_cast<unsigned int>(type)][rotation & 3][direction > 0 ? 0 : 1];
+	}
+
+	/*
+		Reads a piece set from a text file, see resources/pieces for the format.
+		Throws std::runtime_error if the file can not be opened or is malformed.
+	*/
+	static PieceSet Load(const char* fileName);
+};
+
+constexpr PieceSet MakeStandardPieceSet()
+{
+	constexpr float colors[c_NUM_PIECE_TYPES][3] =
+	{
+		{ 1.0f, 1.0f, 0.0f }, // O
+		{ 0.0f, 1.0f, 1.0f }, // I
+		{ 0.0f, 0.0f, 1.0f }, // J
+		{ 1.0f, 0.5f, 0.0f }, // L
+		{ 0.0f, 1.0f, 0.0f }, // S
+		{ 0.5f, 0.0f, 0.5f }, // T
+		{ 1.0f, 0.0f, 0.0f }, // Z
+	};
+
+	PieceSet set = {};
+	for (unsigned int type = 0; type < c_NUM_PIECE_TYPES; type++)
+	{
+		KickRule rule = KickRule::SRS;
+		if (type == static_cast<unsigned int>(PieceType::O))
+			rule = KickRule::NONE;
+		else if (type == static_cast<unsigned int>(PieceType::I))
+			rule = KickRule::SRS_I;
+
+		set.AddPiece("OIJLSTZ"[type], colors[type], c_SHAPES[type], rule, 1);
+	}
+
+	return set;
+}
+
+// The seven tetrominoes with SRS rotation, built at compile time.
+inline constexpr PieceSet c_STANDARD_PIECES = MakeStandardPieceSet();
+
+inline const PieceRotation& GetRotation(PieceType type, unsigned int rotation)
+{
+	return c_STANDARD_PIECES.GetRotation(type, rotation);
+}
+
+// Fills cells with the board position of every block in the piece and returns how many there are.
+unsigned int GetPieceCells(const PieceState& piece, Cell cells[c_MAX_PIECE_BLOCKS], const PieceSet& pieces = c_STANDARD_PIECES);
+
+// Returns the piece in its spawn orientation at the top of a board with numCols columns.
+PieceState SpawnState(PieceType type, unsigned int numCols, const PieceSet& pieces = c_STANDARD_PIECES);
+
+char PieceName(PieceType type, const PieceSet& pieces = c_STANDARD_PIECES);
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include "piece.h"
+
+/*
+	The upcoming pieces, dealt by the randomizer ahead of time so they can be
+	shown and planned around. A fixed ring buffer inside the game state, so
+	reading it never copies or allocates and saving the game saves the queue.
+*/
+struct PieceQueue
+{
+	static constexpr unsigned int c_MIN_DEPTH = 1;
+	static constexpr unsigned int c_MAX_DEPTH = 14;
+	static constexpr unsigned int c_DEFAULT_DEPTH = 5;
+
+	// One more slot than the deepest queue for the piece dealt on spawn, rounded up to a power of two for the wrap around.
+	static constexpr unsigned int c_CAPACITY = 16;
+	static_assert((c_CAPACITY & (c_CAPACITY - 1)) == 0 && c_CAPACITY > c_MAX_DEPTH, "Capacity must be a power of two larger than the deepest queue");
+
+	uint8_t pieces[c_CAPACITY];
+	uint8_t head;
+	uint8_t count;
+	uint8_t depth; // Pieces the game keeps dealt ahead
+
+	void Clear()
+	{
+		head = 0;
+		count = 0;
+	}
+
+	// Pieces shown ahead, there can be more dealt if the queue was made shorter.
+	unsigned int Size() const
+	{
+		return count < depth ? count : depth;
+	}
+
+	// The i-th upcoming piece, 0 being the next to spawn.
+	PieceType operator[](unsigned int i) const
+	{
+		return static_cast<PieceType>(pieces[(head + i) & (c_CAPACITY - 1)]);
+	}
+
+	void Push(PieceType type)
+	{
+		pieces[(head + count) & (c_CAPACITY - 1)] = static_cast<uint8_t>(type);
+		count++;
+	}
+
+	PieceType Pop()
+	{
+		PieceType type = static_cast<PieceType>(pieces[head]);
+		head = (head + 1) & (c_CAPACITY - 1);
+		count--;
+		return type;
+	}
+};
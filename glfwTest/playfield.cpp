@@ -0,0 +1,6 @@
+#include "playfield.h"
+
+// The board sizes used by the game modes are compiled once here.
+template class BasicPlayfield<10, 20>;
+template class BasicPlayfield<10, 40>;
+template class BasicPlayfield<64, 20>;
@@ -0,0 +1,688 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "piece.h"
+#include "bits.h"
+#include "zobrist.h"
+
+/*
+	Narrowest unsigned type that can hold a row mask of Cols columns.
+*/
+template <unsigned int Cols>
+using RowMask = typename std::conditional<(Cols <= 16), uint16_t,
+	typename std::conditional<(Cols <= 32), uint32_t, uint64_t>::type>::type;
+
+/*
+	Bitboard of the locked blocks on the board. Every row is a mask where bit n is
+	set when column n is occupied. Row 0 is the top of the board, the same as the
+	row indices used by the Board class.
+
+	The size is fixed at compile time so the common 10 x 20 board has no runtime
+	dimension checks and stores each row in 16 bits. Boards can be up to 64 wide
+	and 64 tall.
+*/
+template <unsigned int Cols, unsigned int Rows>
+class BasicPlayfield
+{
+public:
+	using Row = RowMask<Cols>;
+	using RowArray = std::array<Row, Rows>;
+
+	static_assert(Cols >= 4 && Cols <= 64, "Boards must be 4 to 64 columns wide");
+	static_assert(Rows >= 4 && Rows <= 64, "Boards must be 4 to 64 rows tall");
+
+	static constexpr unsigned int c_NUM_ROWS = Rows;
+	static constexpr unsigned int c_NUM_COLS = Cols;
+	static constexpr Row c_FULL_ROW = static_cast<Row>(Cols == 64 ? ~0ull : (1ull << Cols) - 1);
+
+	BasicPlayfield();
+	void Clear();
+
+	Row GetRow(unsigned int row) const;
+	const RowArray& GetRows() const;
+	bool IsOccupied(unsigned int row, unsigned int col) const;
+	void SetOccupied(unsigned int row, unsigned int col);
+
+	// Returns true if any of the bits in mask are already set in the row.
+	// Rows outside of the board count as occupied.
+	bool Collides(int row, Row mask) const;
+	void Place(unsigned int row, Row mask);
+
+	// Mask tests of the piece's rows against the board, pieces poking out of the board collide.
+	bool Collides(const PieceState& piece, const PieceSet& pieces = c_STANDARD_PIECES) const;
+	void Place(const PieceState& piece, const PieceSet& pieces = c_STANDARD_PIECES);
+
+	bool IsRowFull(unsigned int row) const;
+
+	/*
+		Occupancy of the 4 row by 8 column window whose top left cell is row, col,
+		packed 8 bits per row with bit 0 of each byte being column col. Cells off
+		the board are set, so a whole neighbourhood can be tested with one mask.
+	*/
+	uint32_t GetWindow(int row, int col) const;
+
+	/*
+		Removes every full row between top and bottom (inclusive) and moves the rows
+		above them down in a single pass, so up to four rows are cleared at once.
+		Only the rows a piece was just placed on can be full, so callers pass those.
+
+		Returns a mask with bit n set for each cleared row n, numbered from before the clear.
+	*/
+	uint64_t ClearFullRows(unsigned int top, unsigned int bottom);
+	uint64_t ClearFullRows();
+
+	/*
+		Pushes the stack up by lines rows and fills the bottom with garbage rows that
+		are full apart from holeCol, moving every row with one memmove. Returns
+		false if blocks were pushed off the top of the board.
+	*/
+	bool InsertGarbage(unsigned int lines, unsigned int holeCol);
+
+	/*
+		Cascade gravity, run after a clear: the stack splits into clusters of blocks
+		joined edge to edge and each one falls on its own until nothing can move.
+		Any rows that fills are cleared and the clusters fall again, until a fall
+		clears nothing. Clusters are found by flood filling whole row masks at once.
+
+		onDrop(const RowArray& cluster, unsigned int distance) is called for every
+		cluster that falls, with the cluster where it was before the fall, and
+		onClear(uint64_t rows) for every set of rows cleared along the way.
+		Returns the number of rows cleared.
+	*/
+	template <typename DropCallback, typename ClearCallback>
+	unsigned int Cascade(DropCallback&& onDrop, ClearCallback&& onClear);
+	unsigned int Cascade();
+
+	// Number of rows from the bottom of the board to the highest block in the column, 0 if empty.
+	unsigned int GetHeight(unsigned int col) const;
+
+	/*
+		Number of rows the piece can fall before landing. Normally worked out from the
+		column heights alone, only a piece tucked under an overhang has to be tested
+		row by row. The piece must currently fit on the board.
+	*/
+	int DropDistance(const PieceState& piece, const PieceSet& pieces = c_STANDARD_PIECES) const;
+
+	// Zobrist hash of the occupied cells, updated as blocks are placed and rows cleared.
+	uint64_t GetHash() const;
+
+	// Works the hash out from scratch, for checking the incremental one.
+	uint64_t ComputeHash() const;
+
+private:
+	static const ZobristTable<Rows, Cols> s_zobrist;
+
+	static Row ShiftMask(uint16_t mask, int x);
+	static Row FillRuns(Row seeds, Row occupied);
+	static void FloodFill(const RowArray& occupied, unsigned int bottom, unsigned int top, RowArray& cluster);
+	template <typename DropCallback>
+	bool SettleClusters(DropCallback& onDrop);
+	void RaiseHeights(unsigned int row, Row mask);
+	void RecomputeHeights();
+	unsigned int GetStackTop() const;
+
+	std::array<Row, Rows> m_rows; // 20 rows x 2 bytes = 40 bytes for the standard board
+	std::array<uint8_t, Cols> m_heights; // Kept up to date on every place and clear
+	uint64_t m_hash;
+};
+
+// The standard board, a tall board with the 20 row buffer zone above it and the widest board.
+using Playfield = BasicPlayfield<10, 20>;
+using TallPlayfield = BasicPlayfield<10, 40>;
+using WidePlayfield = BasicPlayfield<64, 20>;
+
+// Instantiated once in playfield.cpp.
+extern template class BasicPlayfield<10, 20>;
+extern template class BasicPlayfield<10, 40>;
+extern template class BasicPlayfield<64, 20>;
+
+template <unsigned int Cols, unsigned int Rows>
+const ZobristTable<Rows, Cols> BasicPlayfield<Cols, Rows>::s_zobrist;
+
+// Moves a bounding box row mask to the piece's column. The bounds checks make sure
+// no blocks are lost when the box hangs off the left side of the board.
+template <unsigned int Cols, unsigned int Rows>
+inline typename BasicPlayfield<Cols, Rows>::Row BasicPlayfield<Cols, Rows>::ShiftMask(uint16_t mask, int x)
+{
+	return static_cast<Row>(x >= 0 ? static_cast<Row>(mask) << x : mask >> -x);
+}
+
+template <unsigned int Cols, unsigned int Rows>
+BasicPlayfield<Cols, Rows>::BasicPlayfield()
+{
+	Clear();
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::Clear()
+{
+	m_rows.fill(0);
+	m_heights.fill(0);
+	m_hash = 0;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline typename BasicPlayfield<Cols, Rows>::Row BasicPlayfield<Cols, Rows>::GetRow(unsigned int row) const
+{
+	return m_rows[row];
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline const typename BasicPlayfield<Cols, Rows>::RowArray& BasicPlayfield<Cols, Rows>::GetRows() const
+{
+	return m_rows;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline bool BasicPlayfield<Cols, Rows>::IsOccupied(unsigned int row, unsigned int col) const
+{
+	// Anything off the board is treated as a wall.
+	if (row >= Rows || col >= Cols)
+		return true;
+
+	return (m_rows[row] >> col) & 1u;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::SetOccupied(unsigned int row, unsigned int col)
+{
+	Place(row, static_cast<Row>(static_cast<Row>(1) << col));
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline bool BasicPlayfield<Cols, Rows>::Collides(int row, Row mask) const
+{
+	if (row < 0 || row >= static_cast<int>(Rows) || (mask & ~c_FULL_ROW))
+		return mask != 0;
+
+	return (m_rows[row] & mask) != 0;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::Place(unsigned int row, Row mask)
+{
+	m_hash ^= s_zobrist.RowKey(row, mask & ~m_rows[row]);
+	m_rows[row] |= mask;
+	RaiseHeights(row, mask);
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline bool BasicPlayfield<Cols, Rows>::Collides(const PieceState& piece, const PieceSet& pieces) const
+{
+	const PieceRotation& rotation = pieces.GetRotation(piece.type, piece.rotation);
+
+	if (piece.x + rotation.minCol < 0 || piece.x + rotation.maxCol >= static_cast<int>(Cols) ||
+		piece.y + rotation.minRow < 0 || piece.y + rotation.maxRow >= static_cast<int>(Rows))
+		return true;
+
+	for (int row = rotation.minRow; row <= rotation.maxRow; row++)
+	{
+		if (m_rows[piece.y + row] & ShiftMask(rotation.rowMasks[row], piece.x))
+			return true;
+	}
+
+	return false;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::Place(const PieceState& piece, const PieceSet& pieces)
+{
+	const PieceRotation& rotation = pieces.GetRotation(piece.type, piece.rotation);
+
+	for (int row = rotation.minRow; row <= rotation.maxRow; row++)
+	{
+		const Row mask = ShiftMask(rotation.rowMasks[row], piece.x);
+		m_hash ^= s_zobrist.RowKey(piece.y + row, mask & ~m_rows[piece.y + row]);
+		m_rows[piece.y + row] |= mask;
+	}
+
+	for (int col = rotation.minCol; col <= rotation.maxCol; col++)
+	{
+		uint8_t height = static_cast<uint8_t>(Rows - (piece.y + rotation.tops[col]));
+		if (height > m_heights[piece.x + col])
+			m_heights[piece.x + col] = height;
+	}
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline bool BasicPlayfield<Cols, Rows>::IsRowFull(unsigned int row) const
+{
+	return m_rows[row] == c_FULL_ROW;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+uint32_t BasicPlayfield<Cols, Rows>::GetWindow(int row, int col) const
+{
+	uint32_t window = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		uint64_t bits = ~0ull;
+		if (row + i >= 0 && row + i < static_cast<int>(Rows) && col > -8 && col < static_cast<int>(Cols))
+		{
+			// Columns past the right side of the board read as walls.
+			const uint64_t walled = m_rows[row + i] | ~static_cast<uint64_t>(c_FULL_ROW);
+			if (col >= 0)
+				bits = (walled >> col) | (col > 0 ? ~0ull << (64 - col) : 0);
+			else
+				bits = (walled << -col) | ((1ull << -col) - 1);
+		}
+
+		window |= static_cast<uint32_t>(bits & 0xFF) << (i * 8);
+	}
+
+	return window;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+uint64_t BasicPlayfield<Cols, Rows>::ClearFullRows(unsigned int top, unsigned int bottom)
+{
+	uint64_t cleared = 0;
+	for (unsigned int row = top; row <= bottom; row++)
+	{
+		if (m_rows[row] == c_FULL_ROW)
+			cleared |= 1ull << row;
+	}
+
+	if (!cleared)
+		return 0;
+
+	// Every row from the top of the stack down to bottom can change, take them out of
+	// the hash now and add them back once they have moved.
+	const unsigned int stackTop = GetStackTop();
+
+	for (unsigned int row = stackTop; row <= bottom; row++)
+	{
+		m_hash ^= s_zobrist.RowKey(row, m_rows[row]);
+	}
+
+	// Compact the rows between top and bottom that are staying.
+	unsigned int dest = bottom;
+	for (unsigned int row = bottom + 1; row-- > top;)
+	{
+		if (!(cleared & (1ull << row)))
+			m_rows[dest--] = m_rows[row];
+	}
+
+	// Everything above top moves down by the number of cleared rows in one go.
+	const unsigned int shift = dest + 1 - top;
+	std::memmove(&m_rows[shift], &m_rows[0], sizeof(Row) * top);
+	std::memset(&m_rows[0], 0, sizeof(Row) * shift);
+
+	for (unsigned int row = stackTop; row <= bottom; row++)
+	{
+		m_hash ^= s_zobrist.RowKey(row, m_rows[row]);
+	}
+
+	RecomputeHeights();
+
+	return cleared;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+uint64_t BasicPlayfield<Cols, Rows>::ClearFullRows()
+{
+	return ClearFullRows(0, Rows - 1);
+}
+
+template <unsigned int Cols, unsigned int Rows>
+bool BasicPlayfield<Cols, Rows>::InsertGarbage(unsigned int lines, unsigned int holeCol)
+{
+	if (lines == 0)
+		return true;
+	if (lines > Rows)
+		lines = Rows;
+
+	const unsigned int stackTop = GetStackTop();
+	const bool fits = stackTop >= lines;
+
+	for (unsigned int row = stackTop; row < Rows; row++)
+	{
+		m_hash ^= s_zobrist.RowKey(row, m_rows[row]);
+	}
+
+	std::memmove(&m_rows[0], &m_rows[lines], sizeof(Row) * (Rows - lines));
+
+	const Row garbage = static_cast<Row>(c_FULL_ROW & ~(static_cast<Row>(1) << holeCol));
+	for (unsigned int row = Rows - lines; row < Rows; row++)
+	{
+		m_rows[row] = garbage;
+	}
+
+	for (unsigned int row = fits ? stackTop - lines : 0; row < Rows; row++)
+	{
+		m_hash ^= s_zobrist.RowKey(row, m_rows[row]);
+	}
+
+	// Every column grows by the garbage, apart from the hole if nothing is above it.
+	for (unsigned int col = 0; col < Cols; col++)
+	{
+		unsigned int height = m_heights[col] ? m_heights[col] + lines : (col == holeCol ? 0 : lines);
+		m_heights[col] = static_cast<uint8_t>(height < Rows ? height : Rows);
+	}
+
+	// A block pushed off the top may have been the highest in its column.
+	if (!fits)
+		RecomputeHeights();
+
+	return fits;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+template <typename DropCallback, typename ClearCallback>
+unsigned int BasicPlayfield<Cols, Rows>::Cascade(DropCallback&& onDrop, ClearCallback&& onClear)
+{
+	unsigned int cleared = 0;
+
+	while (SettleClusters(onDrop))
+	{
+		const uint64_t rows = ClearFullRows();
+		if (!rows)
+			break;
+
+		onClear(rows);
+		cleared += PopCount64(rows);
+	}
+
+	return cleared;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+unsigned int BasicPlayfield<Cols, Rows>::Cascade()
+{
+	return Cascade([](const RowArray&, unsigned int) {}, [](uint64_t) {});
+}
+
+// Grows every seed to cover the whole run of occupied cells it is in, a Kogge-Stone
+// fill in each direction so it takes log2(Cols) steps whatever the run lengths.
+template <unsigned int Cols, unsigned int Rows>
+inline typename BasicPlayfield<Cols, Rows>::Row BasicPlayfield<Cols, Rows>::FillRuns(Row seeds, Row occupied)
+{
+	Row left = seeds, leftRun = occupied;
+	Row right = seeds, rightRun = occupied;
+
+	for (unsigned int shift = 1; shift < Cols; shift *= 2)
+	{
+		left |= leftRun & static_cast<Row>(left << shift);
+		leftRun &= static_cast<Row>(leftRun << shift);
+		right |= rightRun & static_cast<Row>(right >> shift);
+		rightRun &= static_cast<Row>(rightRun >> shift);
+	}
+
+	return left | right;
+}
+
+// Grows the seeds already in cluster, none of them below bottom, to every block of
+// occupied connected to them. Sweeps up and then back down the rows until the way
+// down adds nothing, only visiting the rows the cluster has reached.
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::FloodFill(const RowArray& occupied, unsigned int bottom, unsigned int top, RowArray& cluster)
+{
+	unsigned int clusterTop = bottom;
+	for (unsigned int row = top; row <= bottom; row++)
+	{
+		if (cluster[row] && row < clusterTop)
+			clusterTop = row;
+	}
+
+	cluster[bottom] = FillRuns(cluster[bottom], occupied[bottom]);
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (unsigned int row = bottom; row-- > top;)
+		{
+			const Row grown = FillRuns(static_cast<Row>((cluster[row] | cluster[row + 1]) & occupied[row]), occupied[row]);
+
+			// Nothing above a row the cluster does not reach can be part of it yet.
+			if (!grown && row < clusterTop)
+				break;
+
+			cluster[row] = grown;
+			if (row < clusterTop)
+				clusterTop = row;
+		}
+
+		for (unsigned int row = clusterTop + 1; row <= bottom; row++)
+		{
+			const Row grown = FillRuns(static_cast<Row>((cluster[row] | cluster[row - 1]) & occupied[row]), occupied[row]);
+			changed |= grown != cluster[row];
+			cluster[row] = grown;
+		}
+	}
+}
+
+/*
+	Drops every floating cluster as far as it will go, lowest first. A cluster that
+	lands on the floor or on a settled block is settled itself, only one resting
+	on a cluster that has not fallen yet needs another pass. Returns true if
+	anything fell.
+*/
+template <unsigned int Cols, unsigned int Rows>
+template <typename DropCallback>
+bool BasicPlayfield<Cols, Rows>::SettleClusters(DropCallback& onDrop)
+{
+	const unsigned int top = GetStackTop();
+	if (top >= Rows)
+		return false;
+
+	bool anyFell = false;
+	bool again = true;
+	RowArray settled = {};
+	RowArray floating = {};
+	RowArray cluster = {};
+
+	while (again)
+	{
+		again = false;
+		bool fell = false;
+
+		// Everything joined to the floor stays put. Columns solid down to the floor seed
+		// the fill so it settles in a sweep or two.
+		settled[Rows - 1] = m_rows[Rows - 1];
+		for (unsigned int row = Rows - 1; row-- > top;)
+		{
+			settled[row] = m_rows[row] & settled[row + 1];
+		}
+		FloodFill(m_rows, Rows - 1, top, settled);
+
+		Row anyFloating = 0;
+		for (unsigned int row = top; row < Rows; row++)
+		{
+			floating[row] = static_cast<Row>(m_rows[row] & ~settled[row]);
+			anyFloating |= floating[row];
+		}
+
+		if (!anyFloating)
+			break;
+
+		for (unsigned int seedRow = Rows - 1; seedRow-- > top;)
+		{
+			while (floating[seedRow])
+			{
+				for (unsigned int row = top; row < Rows; row++)
+				{
+					cluster[row] = 0;
+				}
+				cluster[seedRow] = static_cast<Row>(floating[seedRow] & (0 - floating[seedRow]));
+				FloodFill(floating, seedRow, top, cluster);
+
+				unsigned int clusterTop = seedRow;
+				for (unsigned int row = top; row <= seedRow; row++)
+				{
+					floating[row] &= static_cast<Row>(~cluster[row]);
+					if (cluster[row] && row < clusterTop)
+						clusterTop = row;
+				}
+
+				// The seed is in the lowest row of the cluster, so it can fall until it meets the floor or another block.
+				unsigned int distance = 0;
+				bool onSettled = false;
+				for (bool blocked = false; !blocked;)
+				{
+					if (seedRow + distance + 1 >= Rows)
+					{
+						onSettled = true;
+						break;
+					}
+
+					for (unsigned int row = clusterTop; row <= seedRow; row++)
+					{
+						const unsigned int below = row + distance + 1;
+						const Row clusterBelow = below <= seedRow ? cluster[below] : 0;
+						const Row contact = m_rows[below] & static_cast<Row>(~clusterBelow) & cluster[row];
+
+						blocked |= contact != 0;
+						onSettled |= (contact & settled[below]) != 0;
+					}
+
+					if (!blocked)
+						distance++;
+				}
+
+				// Resting on a cluster that is still to fall, try again once it has.
+				if (!onSettled)
+					again = true;
+
+				if (distance > 0)
+				{
+					onDrop(static_cast<const RowArray&>(cluster), distance);
+
+					for (unsigned int row = clusterTop; row <= seedRow; row++)
+					{
+						m_rows[row] &= static_cast<Row>(~cluster[row]);
+					}
+					for (unsigned int row = seedRow + 1; row-- > clusterTop;)
+					{
+						m_rows[row + distance] |= cluster[row];
+					}
+
+					fell = true;
+					anyFell = true;
+				}
+
+				if (onSettled)
+				{
+					for (unsigned int row = clusterTop; row <= seedRow; row++)
+					{
+						settled[row + distance] |= cluster[row];
+					}
+				}
+			}
+		}
+
+		// Clusters hooked into each other can hold each other up, stop once a pass moves nothing.
+		again = again && fell;
+	}
+
+	if (anyFell)
+	{
+		m_hash = ComputeHash();
+		RecomputeHeights();
+	}
+
+	return anyFell;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline unsigned int BasicPlayfield<Cols, Rows>::GetHeight(unsigned int col) const
+{
+	return m_heights[col];
+}
+
+template <unsigned int Cols, unsigned int Rows>
+int BasicPlayfield<Cols, Rows>::DropDistance(const PieceState& piece, const PieceSet& pieces) const
+{
+	const PieceRotation& rotation = pieces.GetRotation(piece.type, piece.rotation);
+	int distance = Rows;
+
+	for (int col = rotation.minCol; col <= rotation.maxCol; col++)
+	{
+		const int bottom = piece.y + rotation.bottoms[col];
+		const int surface = Rows - m_heights[piece.x + col]; // Row of the highest block
+
+		// The piece is below the top of this column, test each row on the way down instead.
+		if (bottom >= surface)
+		{
+			PieceState dropped = piece;
+			for (distance = 0, dropped.y++; !Collides(dropped, pieces); dropped.y++)
+			{
+				distance++;
+			}
+
+			return distance;
+		}
+
+		if (surface - 1 - bottom < distance)
+			distance = surface - 1 - bottom;
+	}
+
+	return distance;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+inline uint64_t BasicPlayfield<Cols, Rows>::GetHash() const
+{
+	return m_hash;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+uint64_t BasicPlayfield<Cols, Rows>::ComputeHash() const
+{
+	uint64_t hash = 0;
+	for (unsigned int row = 0; row < Rows; row++)
+	{
+		hash ^= s_zobrist.RowKey(row, m_rows[row]);
+	}
+
+	return hash;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::RaiseHeights(unsigned int row, Row mask)
+{
+	const uint8_t height = static_cast<uint8_t>(Rows - row);
+
+	for (uint64_t bits = mask; bits; bits &= bits - 1)
+	{
+		unsigned int col = CountTrailingZeros64(bits);
+		if (height > m_heights[col])
+			m_heights[col] = height;
+	}
+}
+
+// Row of the highest block on the board, Rows if the board is empty.
+template <unsigned int Cols, unsigned int Rows>
+unsigned int BasicPlayfield<Cols, Rows>::GetStackTop() const
+{
+	unsigned int stackTop = Rows;
+	for (unsigned int col = 0; col < Cols; col++)
+	{
+		if (Rows - m_heights[col] < stackTop)
+			stackTop = Rows - m_heights[col];
+	}
+
+	return stackTop;
+}
+
+template <unsigned int Cols, unsigned int Rows>
+void BasicPlayfield<Cols, Rows>::RecomputeHeights()
+{
+	m_heights.fill(0);
+
+	// Walk down from the top, the first block found in a column sets its height.
+	uint64_t found = 0;
+	for (unsigned int row = 0; row < Rows && found != c_FULL_ROW; row++)
+	{
+		uint64_t newCols = m_rows[row] & ~found;
+		found |= newCols;
+
+		for (; newCols; newCols &= newCols - 1)
+		{
+			m_heights[CountTrailingZeros64(newCols)] = static_cast<uint8_t>(Rows - row);
+		}
+	}
+}
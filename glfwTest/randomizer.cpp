@@ -0,0 +1,98 @@
+#include "randomizer.h"
+#include <cstring>
+#include <type_traits>
+#include "bits.h"
+
+static_assert(std::is_trivially_destructible<BagRandomizer>::value, "The default randomizer must not need a destructor registered at startup");
+const BagRandomizer c_DEFAULT_RANDOMIZER;
+
+static uint32_t RotateLeft(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+void Xoshiro128::Seed(uint64_t seed)
+{
+	// Expand the seed with splitmix64 so similar seeds still give unrelated streams.
+	for (unsigned int i = 0; i < 4; i += 2)
+	{
+		uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z = z ^ (z >> 31);
+
+		state[i] = static_cast<uint32_t>(z);
+		state[i + 1] = static_cast<uint32_t>(z >> 32);
+	}
+}
+
+uint32_t Xoshiro128::Next()
+{
+	const uint32_t result = RotateLeft(state[1] * 5, 7) * 9;
+	const uint32_t t = state[1] << 9;
+
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = RotateLeft(state[3], 11);
+
+	return result;
+}
+
+uint32_t Xoshiro128::NextBelow(uint32_t n)
+{
+	return static_cast<uint32_t>((static_cast<uint64_t>(Next()) * n) >> 32);
+}
+
+void BagRandomizer::Seed(RandomizerState& state, uint64_t seed) const
+{
+	state.rng.Seed(seed);
+	SetBag(state, 0);
+}
+
+PieceType BagRandomizer::Next(RandomizerState& state, unsigned int numTypes) const
+{
+	const uint32_t full = numTypes >= 32 ? ~0u : (1u << numTypes) - 1;
+
+	// Only pieces of the current set count, in case the set changed part way through a bag.
+	uint32_t bag = GetBag(state) & full;
+	if (bag == 0)
+		bag = full;
+
+	// Drawing a random piece from what is left deals the same orders as shuffling the whole bag.
+	uint32_t pick = state.rng.NextBelow(PopCount(bag));
+	uint32_t remaining = bag;
+	while (pick--)
+	{
+		remaining &= remaining - 1;
+	}
+
+	const unsigned int type = CountTrailingZeros(remaining);
+	SetBag(state, bag & ~(1u << type));
+
+	return static_cast<PieceType>(type);
+}
+
+uint32_t BagRandomizer::GetBag(const RandomizerState& state)
+{
+	uint32_t bag;
+	std::memcpy(&bag, state.data, sizeof(bag));
+	return bag;
+}
+
+void BagRandomizer::SetBag(RandomizerState& state, uint32_t bag)
+{
+	std::memcpy(state.data, &bag, sizeof(bag));
+}
+
+void UniformRandomizer::Seed(RandomizerState& state, uint64_t seed) const
+{
+	state.rng.Seed(seed);
+}
+
+PieceType UniformRandomizer::Next(RandomizerState& state, unsigned int numTypes) const
+{
+	return static_cast<PieceType>(state.rng.NextBelow(numTypes));
+}
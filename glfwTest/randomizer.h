@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include "piece.h"
+
+/*
+	xoshiro128** generator. Small, fast and fully determined by its seed so games
+	can be replayed and parallel simulations each get their own stream.
+*/
+struct Xoshiro128
+{
+	uint32_t state[4];
+
+	void Seed(uint64_t seed);
+	uint32_t Next();
+
+	// Returns a number in [0, n).
+	uint32_t NextBelow(uint32_t n);
+};
+
+/*
+	Everything a randomizer needs to remember between pieces. Fixed size and
+	trivially copyable so it can be saved with the rest of the game state.
+*/
+struct RandomizerState
+{
+	Xoshiro128 rng;
+	uint8_t data[8]; // Free for the randomizer to use, e.g. the current bag
+};
+
+/*
+	Decides the order the pieces are dealt in. Randomizers hold no state of their
+	own, it all lives in the RandomizerState they are given, so one randomizer can
+	be shared by any number of games. Implement this to add other randomizer rules
+	and hand it to Game::SetRandomizer.
+
+	Games only point at a randomizer and never delete one through this class, so
+	the destructor is left trivial and a randomizer defined at namespace scope is
+	set up at compile time, with nothing to run before main or at exit.
+*/
+class Randomizer
+{
+public:
+	constexpr Randomizer() = default;
+	virtual void Seed(RandomizerState& state, uint64_t seed) const = 0;
+
+	// Returns the next piece out of the first numTypes pieces of the piece set.
+	virtual PieceType Next(RandomizerState& state, unsigned int numTypes) const = 0;
+
+protected:
+	~Randomizer() = default;
+};
+
+/*
+	Deals every piece of the set once, in a random order, before starting a new
+	bag, so the same piece never comes up more than twice in a row.
+*/
+class BagRandomizer : public Randomizer
+{
+public:
+	constexpr BagRandomizer() = default;
+
+	void Seed(RandomizerState& state, uint64_t seed) const override;
+	PieceType Next(RandomizerState& state, unsigned int numTypes) const override;
+
+private:
+	// data[0 - 3] holds a bit for every piece still left in the bag.
+	static uint32_t GetBag(const RandomizerState& state);
+	static void SetBag(RandomizerState& state, uint32_t bag);
+};
+
+/*
+	Picks every piece independently with the same chance.
+*/
+class UniformRandomizer : public Randomizer
+{
+public:
+	constexpr UniformRandomizer() = default;
+
+	void Seed(RandomizerState& state, uint64_t seed) const override;
+	PieceType Next(RandomizerState& state, unsigned int numTypes) const override;
+};
+
+// The 7-bag randomizer games use unless told otherwise. Ready before any dynamic initialization, so a Game at namespace scope in any file can use it.
+extern const BagRandomizer c_DEFAULT_RANDOMIZER;
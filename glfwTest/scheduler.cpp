@@ -0,0 +1,119 @@
+#include "scheduler.h"
+
+void Scheduler::Schedule(unsigned int game, uint64_t tick)
+{
+	if (game >= m_positions.size())
+		m_positions.resize(game + 1, c_NOT_SCHEDULED);
+
+	unsigned int index = m_positions[game];
+	if (index == c_NOT_SCHEDULED)
+	{
+		index = static_cast<unsigned int>(m_heap.size());
+		m_heap.push_back({ tick, game });
+		m_positions[game] = index;
+		SiftUp(index);
+		return;
+	}
+
+	// Moved earlier it can only go up the heap, moved later only down.
+	const uint64_t oldTick = m_heap[index].tick;
+	m_heap[index].tick = tick;
+	if (tick < oldTick)
+		SiftUp(index);
+	else
+		SiftDown(index);
+}
+
+void Scheduler::Cancel(unsigned int game)
+{
+	if (IsScheduled(game))
+		Remove(m_positions[game]);
+}
+
+bool Scheduler::IsEmpty() const
+{
+	return m_heap.empty();
+}
+
+bool Scheduler::IsScheduled(unsigned int game) const
+{
+	return game < m_positions.size() && m_positions[game] != c_NOT_SCHEDULED;
+}
+
+uint64_t Scheduler::GetNextDeadline() const
+{
+	return m_heap.empty() ? UINT64_MAX : m_heap[0].tick;
+}
+
+bool Scheduler::PopDue(uint64_t tick, unsigned int& game)
+{
+	if (m_heap.empty() || m_heap[0].tick > tick)
+		return false;
+
+	game = m_heap[0].game;
+	Remove(0);
+	return true;
+}
+
+void Scheduler::Remove(unsigned int index)
+{
+	m_positions[m_heap[index].game] = c_NOT_SCHEDULED;
+
+	// Fill the hole with the last entry and move that to where it belongs.
+	const Entry last = m_heap.back();
+	m_heap.pop_back();
+	if (index == m_heap.size())
+		return;
+
+	const uint64_t oldTick = m_heap[index].tick;
+	Place(index, last);
+	if (last.tick < oldTick)
+		SiftUp(index);
+	else
+		SiftDown(index);
+}
+
+void Scheduler::Place(unsigned int index, const Entry& entry)
+{
+	m_heap[index] = entry;
+	m_positions[entry.game] = index;
+}
+
+void Scheduler::SiftUp(unsigned int index)
+{
+	const Entry entry = m_heap[index];
+	while (index > 0)
+	{
+		const unsigned int parent = (index - 1) / 2;
+		if (m_heap[parent].tick <= entry.tick)
+			break;
+
+		Place(index, m_heap[parent]);
+		index = parent;
+	}
+
+	Place(index, entry);
+}
+
+void Scheduler::SiftDown(unsigned int index)
+{
+	const Entry entry = m_heap[index];
+	const unsigned int size = static_cast<unsigned int>(m_heap.size());
+	while (true)
+	{
+		unsigned int child = index * 2 + 1;
+		if (child >= size)
+			break;
+
+		if (child + 1 < size && m_heap[child + 1].tick < m_heap[child].tick)
+			child++;
+
+		if (entry.tick <= m_heap[child].tick)
+			break;
+
+		Place(index, m_heap[child]);
+		index = child;
+	}
+
+	Place(index, entry);
+}
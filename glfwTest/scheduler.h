@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/*
+	Keeps the next deadline of many games so a host, e.g. a server, can sleep
+	until the earliest one instead of ticking every game on every tick. Deadlines
+	are ticks of a clock the games share, usually the current tick plus
+	Game::GetTicksUntilUpdate. When a game comes due, or gets input, the host
+	catches it up with Game::Tick(ticks) and schedules it again.
+
+	A binary heap indexed by game number, so scheduling, rescheduling and taking
+	the earliest game are all O(log n) however many games are idle.
+*/
+class Scheduler
+{
+public:
+	// Sets the deadline of a game, replacing the one it had. Games are numbered from 0.
+	void Schedule(unsigned int game, uint64_t tick);
+	void Cancel(unsigned int game);
+
+	bool IsEmpty() const;
+	bool IsScheduled(unsigned int game) const;
+
+	// Earliest deadline of all the games, UINT64_MAX if none are scheduled.
+	uint64_t GetNextDeadline() const;
+
+	// Takes off the game with the earliest deadline if it is due by tick, returns false if none are.
+	bool PopDue(uint64_t tick, unsigned int& game);
+
+private:
+	struct Entry
+	{
+		uint64_t tick;
+		unsigned int game;
+	};
+
+	static constexpr unsigned int c_NOT_SCHEDULED = ~0u;
+
+	void Remove(unsigned int index);
+	void Place(unsigned int index, const Entry& entry);
+	void SiftUp(unsigned int index);
+	void SiftDown(unsigned int index);
+
+	std::vector<Entry> m_heap;
+	std::vector<unsigned int> m_positions; // Where each game is in the heap, c_NOT_SCHEDULED if it is not
+};
@@ -0,0 +1,57 @@
+#include "scoring.h"
+
+const unsigned int c_SCORE_TABLE[c_NUM_SPIN_TYPES][c_MAX_SCORED_LINES + 1] =
+{
+	{   0,  100,  300,  500,  800 }, // No spin
+	{ 100,  200,  400,  400,  400 }, // Mini
+	{ 400,  800, 1200, 1600, 1600 }, // Full
+};
+
+const unsigned int c_ATTACK_TABLE[c_NUM_SPIN_TYPES][c_MAX_SCORED_LINES + 1] =
+{
+	{ 0, 0, 1, 2, 4 }, // No spin
+	{ 0, 0, 1, 1, 1 }, // Mini
+	{ 0, 2, 4, 6, 6 }, // Full
+};
+
+const unsigned int c_COMBO_ATTACK_TABLE[c_NUM_COMBO_ATTACKS] =
+{
+	0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5
+};
+
+static unsigned int ScoredLines(const ClearResult& result)
+{
+	return result.lines < c_MAX_SCORED_LINES ? result.lines : c_MAX_SCORED_LINES;
+}
+
+bool IsDifficultClear(const ClearResult& result)
+{
+	return result.lines >= 4 || (result.lines > 0 && result.spin != SpinType::NONE);
+}
+
+unsigned int GetClearScore(const ClearResult& result)
+{
+	unsigned int score = c_SCORE_TABLE[static_cast<unsigned int>(result.spin)][ScoredLines(result)];
+
+	// Back-to-back clears are worth half as much again, and every clear in a combo adds 50 per step.
+	if (result.backToBack)
+		score += score / 2;
+	if (result.lines > 0)
+		score += 50 * result.combo;
+
+	return score;
+}
+
+unsigned int GetClearAttack(const ClearResult& result)
+{
+	if (result.lines == 0)
+		return 0;
+
+	unsigned int attack = c_ATTACK_TABLE[static_cast<unsigned int>(result.spin)][ScoredLines(result)];
+	attack += c_COMBO_ATTACK_TABLE[result.combo < c_NUM_COMBO_ATTACKS ? result.combo : c_NUM_COMBO_ATTACKS - 1];
+
+	if (result.backToBack)
+		attack += c_BACK_TO_BACK_ATTACK;
+
+	return attack;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include "spin.h"
+
+/*
+	What locking a piece achieved, handed to the scoring and attack tables.
+*/
+struct ClearResult
+{
+	uint8_t lines;
+	SpinType spin;
+	uint8_t combo;   // Clears in a row before this one, 0 for the first
+	bool backToBack; // A difficult clear following another with no easy clear between
+	uint8_t attack;  // Garbage rows the clear is worth
+	uint8_t sent;    // What is left of the attack after canceling incoming garbage
+};
+
+// Clears of more lines than this, only possible with bigger pieces, score as this many.
+static constexpr unsigned int c_MAX_SCORED_LINES = 4;
+
+// Points for a clear at level 1, indexed by [spin][lines].
+extern const unsigned int c_SCORE_TABLE[c_NUM_SPIN_TYPES][c_MAX_SCORED_LINES + 1];
+
+// Garbage rows sent to the opponent before combo and back-to-back bonuses, indexed by [spin][lines].
+extern const unsigned int c_ATTACK_TABLE[c_NUM_SPIN_TYPES][c_MAX_SCORED_LINES + 1];
+
+// Extra garbage rows for a combo, indexed by ClearResult::combo. Longer combos use the last entry.
+static constexpr unsigned int c_NUM_COMBO_ATTACKS = 12;
+extern const unsigned int c_COMBO_ATTACK_TABLE[c_NUM_COMBO_ATTACKS];
+
+static constexpr unsigned int c_BACK_TO_BACK_ATTACK = 1;
+
+// Four or more lines, or any spin that clears, keeps a back-to-back chain going.
+bool IsDifficultClear(const ClearResult& result);
+
+unsigned int GetClearScore(const ClearResult& result);
+unsigned int GetClearAttack(const ClearResult& result);
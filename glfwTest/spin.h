@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include "piece.h"
+#include "playfield.h"
+#include "bits.h"
+
+enum class SpinType : uint8_t
+{
+	NONE,
+	MINI,
+	FULL
+};
+
+static constexpr unsigned int c_NUM_SPIN_TYPES = 3;
+
+enum class SpinRule : uint8_t
+{
+	T_SPIN,  // Only the T piece can spin, by the 3-corner rule
+	ALL_SPIN // Other pieces also score a mini spin when they lock unable to move
+};
+
+// Kick index stored for a piece whose last move was not a rotation.
+static constexpr uint8_t c_NO_KICK = 0xFF;
+
+/*
+	Corners of the T piece's 3 x 3 box as masks of a playfield window (see
+	BasicPlayfield::GetWindow): bit row * 8 + col. The front corners are the two
+	on the side the T points to in each rotation.
+*/
+static constexpr uint32_t c_T_CORNERS = (1u << 0) | (1u << 2) | (1u << 16) | (1u << 18);
+static constexpr uint32_t c_T_FRONT_CORNERS[c_NUM_ROTATIONS] =
+{
+	(1u << 0) | (1u << 2),   // Pointing up
+	(1u << 2) | (1u << 18),  // Pointing right
+	(1u << 16) | (1u << 18), // Pointing down
+	(1u << 0) | (1u << 16),  // Pointing left
+};
+
+// The piece the 3-corner rule applies to, the T in the standard set and any piece named T in a 3 x 3 box in others.
+inline bool IsTPiece(PieceType type, const PieceSet& pieces)
+{
+	const unsigned int index = static_cast<unsigned int>(type);
+	return pieces.names[index] == 'T' && pieces.boxSizes[index] == 3;
+}
+
+// True if the piece can not move left, right or up from where it is.
+template <unsigned int Cols, unsigned int Rows>
+bool IsImmobile(const BasicPlayfield<Cols, Rows>& field, const PieceState& piece, const PieceSet& pieces)
+{
+	PieceState moved = piece;
+
+	moved.x = piece.x - 1;
+	if (!field.Collides(moved, pieces))
+		return false;
+
+	moved.x = piece.x + 1;
+	if (!field.Collides(moved, pieces))
+		return false;
+
+	moved.x = piece.x;
+	moved.y = piece.y - 1;
+	return field.Collides(moved, pieces);
+}
+
+/*
+	Works out whether locking the piece where it is, on the stack before it is
+	placed, is a spin. kick is the index of the wall kick used by the piece's
+	last move, or c_NO_KICK if it was not a rotation.
+
+	T-spins use the 3-corner rule: at least three corners of the T's box are
+	filled. It is a full spin if both front corners are filled or the rotation
+	needed the last kick, and a mini otherwise. The corners are tested with one
+	window read and a popcount, so it is cheap enough to run on every candidate
+	placement in a search.
+*/
+template <unsigned int Cols, unsigned int Rows>
+SpinType DetectSpin(const BasicPlayfield<Cols, Rows>& field, const PieceState& piece, uint8_t kick, const PieceSet& pieces = c_STANDARD_PIECES, SpinRule rule = SpinRule::T_SPIN)
+{
+	if (kick == c_NO_KICK)
+		return SpinType::NONE;
+
+	if (IsTPiece(piece.type, pieces))
+	{
+		const uint32_t window = field.GetWindow(piece.y, piece.x);
+		if (PopCount(window & c_T_CORNERS) < 3)
+			return SpinType::NONE;
+
+		const uint32_t front = c_T_FRONT_CORNERS[piece.rotation & 3];
+		if ((window & front) == front || kick == c_NUM_KICKS - 1)
+			return SpinType::FULL;
+
+		return SpinType::MINI;
+	}
+
+	if (rule == SpinRule::ALL_SPIN && IsImmobile(field, piece, pieces))
+		return SpinType::MINI;
+
+	return SpinType::NONE;
+}
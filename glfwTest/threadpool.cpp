@@ -0,0 +1,87 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0)
+		numThreads = 1;
+
+	m_job = nullptr;
+	m_generation = 0;
+	m_running = 0;
+	m_stopping = false;
+
+	for (unsigned int i = 1; i < numThreads; i++)
+	{
+		m_threads.emplace_back(&ThreadPool::Work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_start.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+unsigned int ThreadPool::GetNumThreads() const
+{
+	return static_cast<unsigned int>(m_threads.size()) + 1;
+}
+
+void ThreadPool::Run(const std::function<void(unsigned int)>& job)
+{
+	if (!m_threads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &job;
+			m_running = static_cast<unsigned int>(m_threads.size());
+			m_generation++;
+		}
+		m_start.notify_all();
+	}
+
+	job(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finished.wait(lock, [this]() { return m_running == 0; });
+	m_job = nullptr;
+}
+
+void ThreadPool::Work(unsigned int thread)
+{
+	uint64_t generation = 0;
+
+	while (true)
+	{
+		const std::function<void(unsigned int)>* job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [&]() { return m_stopping || m_generation != generation; });
+			if (m_stopping)
+				return;
+
+			generation = m_generation;
+			job = m_job;
+		}
+
+		(*job)(thread);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			last = --m_running == 0;
+		}
+		if (last)
+			m_finished.notify_one();
+	}
+}
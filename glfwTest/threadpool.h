@@ -0,0 +1,42 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	A fixed set of worker threads that all run the same job and then wait for the
+	next one, for searches that split each step between threads and need them to
+	meet up before the next step. The threads are started once rather than per
+	job, so handing out a job costs a wake up instead of a thread launch.
+*/
+class ThreadPool
+{
+public:
+	// 0 threads means one per hardware thread. The thread calling Run counts as one of them.
+	explicit ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int GetNumThreads() const;
+
+	// Calls job(thread) once on every thread, thread 0 being the caller, and returns when they have all finished.
+	void Run(const std::function<void(unsigned int)>& job);
+
+private:
+	void Work(unsigned int thread);
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_finished;
+
+	const std::function<void(unsigned int)>* m_job;
+	uint64_t m_generation; // Goes up by one for every job, so the workers can tell a new one from the last
+	unsigned int m_running; // Workers still busy with the current job
+	bool m_stopping;
+};
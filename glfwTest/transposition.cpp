@@ -0,0 +1,61 @@
+#include "transposition.h"
+
+static_assert(TranspositionTable::c_BUCKET_SIZE == 4, "Entries are picked by the top two bits of the key");
+
+TranspositionTable::TranspositionTable(size_t bytes)
+{
+	size_t numBuckets = 1;
+	while (numBuckets * 2 * sizeof(Bucket) <= bytes)
+		numBuckets *= 2;
+
+	m_buckets.reset(new Bucket[numBuckets]);
+	m_mask = numBuckets - 1;
+
+	for (size_t i = 0; i < numBuckets; i++)
+	{
+		for (Entry& entry : m_buckets[i].entries)
+		{
+			entry.check.store(0, std::memory_order_relaxed);
+			entry.data.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool TranspositionTable::Probe(uint64_t key, uint64_t& data) const
+{
+	for (const Entry& entry : m_buckets[key & m_mask].entries)
+	{
+		const uint64_t entryData = entry.data.load(std::memory_order_relaxed);
+		if ((entry.check.load(std::memory_order_relaxed) ^ entryData) == key)
+		{
+			data = entryData;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TranspositionTable::Store(uint64_t key, uint64_t data)
+{
+	Bucket& bucket = m_buckets[key & m_mask];
+
+	// The key's own entry if it has one, otherwise one picked by bits of the key the bucket index doesn't use.
+	Entry* slot = &bucket.entries[key >> 62];
+	for (Entry& entry : bucket.entries)
+	{
+		if ((entry.check.load(std::memory_order_relaxed) ^ entry.data.load(std::memory_order_relaxed)) == key)
+		{
+			slot = &entry;
+			break;
+		}
+	}
+
+	slot->check.store(key ^ data, std::memory_order_relaxed);
+	slot->data.store(data, std::memory_order_relaxed);
+}
+
+size_t TranspositionTable::GetNumEntries() const
+{
+	return (m_mask + 1) * c_BUCKET_SIZE;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+	A fixed size hash table from 64 bit keys to 64 bit data that every search
+	thread reads and writes at once, with no locks.
+
+	Each entry is two words stored with relaxed atomics: the data, and the key
+	XORed with the data. A reader XORs the two back together and only trusts the
+	data if that gives its key, so an entry half written by one thread while
+	another reads or writes it, or holding some other key, reads as a miss
+	rather than as wrong data.
+
+	Entries are grouped four to a 64 byte bucket, one cache line. A key can go
+	in any entry of its bucket, taking over its own entry if it has one and an
+	entry picked by the key otherwise, so there is no replacement state to keep.
+*/
+class TranspositionTable
+{
+public:
+	static constexpr unsigned int c_BUCKET_SIZE = 4;
+
+	// The size in bytes is rounded down to a power of two number of buckets, at least one.
+	explicit TranspositionTable(size_t bytes);
+
+	TranspositionTable(const TranspositionTable&) = delete;
+	TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+	// Returns false if key isn't in the table.
+	bool Probe(uint64_t key, uint64_t& data) const;
+	void Store(uint64_t key, uint64_t data);
+
+	size_t GetNumEntries() const;
+
+private:
+	struct Entry
+	{
+		std::atomic<uint64_t> check; // key ^ data
+		std::atomic<uint64_t> data;
+	};
+
+	struct alignas(64) Bucket
+	{
+		Entry entries[c_BUCKET_SIZE];
+	};
+
+	std::unique_ptr<Bucket[]> m_buckets;
+	size_t m_mask;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "piece.h"
+
+/*
+	Zobrist keys for hashing board positions. Every cell has a random 64 bit key and
+	the hash of a board is the XOR of the keys of its occupied cells, so placing or
+	removing blocks only needs the keys of the changed cells XORed in.
+
+	The cell keys of each row are grouped into c_ZOBRIST_CHUNK_BITS wide chunks,
+	with the XOR of every combination of a chunk's cells precomputed, so a whole
+	row mask is hashed with a couple of table lookups instead of a loop over bits.
+*/
+static constexpr unsigned int c_ZOBRIST_CHUNK_BITS = 5;
+static constexpr unsigned int c_ZOBRIST_CHUNK_SIZE = 1u << c_ZOBRIST_CHUNK_BITS;
+
+constexpr uint64_t SplitMix64(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// Key of a single cell, different for every row and column.
+constexpr uint64_t ZobristCellKey(unsigned int row, unsigned int col)
+{
+	return SplitMix64((static_cast<uint64_t>(row) << 8) | col);
+}
+
+template <unsigned int Rows, unsigned int Cols>
+struct ZobristTable
+{
+	static constexpr unsigned int c_NUM_CHUNKS = (Cols + c_ZOBRIST_CHUNK_BITS - 1) / c_ZOBRIST_CHUNK_BITS;
+
+	uint64_t chunks[Rows][c_NUM_CHUNKS][c_ZOBRIST_CHUNK_SIZE];
+
+	constexpr ZobristTable() : chunks()
+	{
+		for (unsigned int row = 0; row < Rows; row++)
+		{
+			for (unsigned int chunk = 0; chunk < c_NUM_CHUNKS; chunk++)
+			{
+				for (unsigned int bits = 1; bits < c_ZOBRIST_CHUNK_SIZE; bits++)
+				{
+					// Reuse the entry without the lowest bit and add the key of that cell.
+					unsigned int low = 0;
+					while (!(bits & (1u << low)))
+						low++;
+
+					const unsigned int col = chunk * c_ZOBRIST_CHUNK_BITS + low;
+					const uint64_t key = col < Cols ? ZobristCellKey(row, col) : 0;
+					chunks[row][chunk][bits] = chunks[row][chunk][bits & (bits - 1)] ^ key;
+				}
+			}
+		}
+	}
+
+	// XOR of the keys of every cell set in mask on the row.
+	uint64_t RowKey(unsigned int row, uint64_t mask) const
+	{
+		uint64_t key = 0;
+		for (unsigned int chunk = 0; chunk < c_NUM_CHUNKS; chunk++)
+		{
+			key ^= chunks[row][chunk][(mask >> (chunk * c_ZOBRIST_CHUNK_BITS)) & (c_ZOBRIST_CHUNK_SIZE - 1)];
+		}
+
+		return key;
+	}
+};
+
+constexpr std::array<uint64_t, c_MAX_PIECE_TYPES> MakeZobristPieceKeys()
+{
+	std::array<uint64_t, c_MAX_PIECE_TYPES> keys = {};
+	for (unsigned int type = 0; type < c_MAX_PIECE_TYPES; type++)
+	{
+		keys[type] = SplitMix64(0xF000 + type);
+	}
+
+	return keys;
+}
+
+// Keys for the type of the falling piece, kept apart from the cell keys.
+inline constexpr std::array<uint64_t, c_MAX_PIECE_TYPES> c_ZOBRIST_PIECE_KEYS = MakeZobristPieceKeys();
+
+// Keys for the held piece and for the piece at each place in the queue, so a queue is hashed by what is dealt where.
+constexpr uint64_t ZobristHoldKey(PieceType type)
+{
+	return SplitMix64(0xF100 + static_cast<uint64_t>(type));
+}
+
+constexpr uint64_t ZobristQueueKey(unsigned int position, PieceType type)
+{
+	return SplitMix64(0x10000 + (static_cast<uint64_t>(position) << 8) + static_cast<uint64_t>(type));
+}